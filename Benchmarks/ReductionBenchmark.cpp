@@ -0,0 +1,284 @@
+/*
+ ==============================================================================
+
+ ReductionBenchmark.cpp
+ Created: 16 Oct 2026 3:18:40pm
+ Author:  Adam Jackson
+
+ Compares the per-sample getRange loop, the vectorised reduction over one
+ ring buffer per stream, a FrameRingBuffer holding every stream, the
+ FrameRingBuffer per channel which the processor keeps, and the quantised
+ PackedFrameRingBuffer per channel. The streams are laid out as the
+ processor's analysis streams, and one channel is read, as a scope does.
+ Needs nothing but a C++17 compiler:
+
+   c++ -O2 -std=c++17 Benchmarks/ReductionBenchmark.cpp -o ReductionBenchmark
+
+ Add -mavx2 (x86) to measure the AVX2 path instead of SSE2.
+
+ ==============================================================================
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include "../Source/ScopeReduction.h"
+#include "../Source/FrameRingBuffer.h"
+
+namespace
+{
+
+// The history buffer as it was, with a modulo in every tapOut
+class ModuloBuffer
+{
+ std::vector<float> storage;
+ int writeIndex {0};
+
+public:
+ void setMaximumLength(int length)
+ { storage.assign(length, 0.f); }
+
+ void tapIn(float sample)
+ {
+  storage[writeIndex] = sample;
+  writeIndex = (writeIndex + 1) % static_cast<int>(storage.size());
+ }
+
+ float tapOut(int index) const
+ {
+  const int size = static_cast<int>(storage.size());
+  return storage[(writeIndex - 1 - index + size) % size];
+ }
+};
+
+SummaryBin legacyRange(const ModuloBuffer *buffers, const int (&streams)[4], int start, int end)
+{
+ const ModuloBuffer &wave = buffers[streams[0]];
+ const ModuloBuffer &bass = buffers[streams[1]];
+ const ModuloBuffer &mids = buffers[streams[2]];
+ const ModuloBuffer &high = buffers[streams[3]];
+ SummaryBin result = SummaryBin::fromSample(wave.tapOut(start),
+                                            bass.tapOut(start),
+                                            mids.tapOut(start),
+                                            high.tapOut(start));
+ for (int i = start + 1; i < end; ++i)
+ {
+  float t = wave.tapOut(i);
+  result.min = std::min(result.min, t);
+  result.max = std::max(result.max, t);
+  result.bass = std::max(result.bass, std::fabs(bass.tapOut(i)));
+  result.mids = std::max(result.mids, std::fabs(mids.tapOut(i)));
+  result.high = std::max(result.high, std::fabs(high.tapOut(i)));
+ }
+ return result;
+}
+
+// One buffer per stream, reduced a linear segment at a time
+class PlanarBuffer
+{
+ std::vector<float> storage;
+ int writeIndex {0};
+
+public:
+ void setMaximumLength(int length)
+ { storage.assign(length, 0.f); }
+
+ void tapIn(float sample)
+ {
+  storage[writeIndex] = sample;
+  if (++writeIndex == static_cast<int>(storage.size())) writeIndex = 0;
+ }
+
+ // Storage offset of tapOut(index)
+ int offsetOf(int index) const
+ {
+  const int offset = writeIndex - 1 - index;
+  return offset < 0 ? offset + static_cast<int>(storage.size()) : offset;
+ }
+
+ int size() const
+ { return static_cast<int>(storage.size()); }
+
+ const float *data() const
+ { return storage.data(); }
+};
+
+SummaryBin planarRange(const PlanarBuffer *buffers, const int (&streams)[4], int start, int end)
+{
+ const PlanarBuffer &wave = buffers[streams[0]];
+ const PlanarBuffer &bass = buffers[streams[1]];
+ const PlanarBuffer &mids = buffers[streams[2]];
+ const PlanarBuffer &high = buffers[streams[3]];
+ const int first = wave.offsetOf(end - 1);
+ SummaryBin result = SummaryBin::fromSample(wave.data()[first],
+                                            bass.data()[first],
+                                            mids.data()[first],
+                                            high.data()[first]);
+ auto span = [&](int offset, int length)
+ {
+  ScopeReduction::reduceSpan(wave.data() + offset,
+                             bass.data() + offset,
+                             mids.data() + offset,
+                             high.data() + offset,
+                             length,
+                             result);
+ };
+ const int count = end - start;
+ if (first + count <= wave.size()) span(first, count);
+ else
+ {
+  span(first, wave.size() - first);
+  span(0, count - (wave.size() - first));
+ }
+ return result;
+}
+
+template <typename Ring>
+SummaryBin interleavedRange(const Ring &ring, const int (&streams)[4], int start, int end)
+{
+ SummaryBin result = SummaryBin::fromSample(ring.tapOut(start, streams[0]),
+                                            ring.tapOut(start, streams[1]),
+                                            ring.tapOut(start, streams[2]),
+                                            ring.tapOut(start, streams[3]));
+ ring.reduce(start, end, streams, result);
+ return result;
+}
+
+bool sameBin(const SummaryBin &a, const SummaryBin &b)
+{
+ return a.min == b.min && a.max == b.max && a.bass == b.bass && a.mids == b.mids && a.high == b.high;
+}
+
+template <typename Function>
+double timeColumns(Function &&function, int windowSize, int columns, int repeats, float &sink)
+{
+ // The best of a few runs, as anything else on the machine only adds time
+ double best = 0.;
+ for (int run = 0; run < 5; ++run)
+ {
+  const auto begin = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeats; ++r)
+  {
+   for (int c = 0; c < columns; ++c)
+   {
+    const int start = static_cast<int>(static_cast<long long>(c)*windowSize/columns);
+    const int end = static_cast<int>(static_cast<long long>(c + 1)*windowSize/columns);
+    sink += function(start, std::max(end, start + 1)).max;
+   }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+  if (run == 0 || elapsed.count() < best) best = elapsed.count();
+ }
+ return best/repeats;
+}
+
+}
+
+int main()
+{
+ // XDLightScopeAudioProcessor's analysis streams, two channels side by side
+ // band by band, and each channel's streams in its own ring
+ constexpr int NumStreams = 8;
+ constexpr int Left[4] = {0, 2, 4, 6};
+ constexpr int Channel[4] = {0, 1, 2, 3};
+ 
+ constexpr int HistoryLength = 5*44100;
+ ModuloBuffer legacy[NumStreams];
+ PlanarBuffer planar[NumStreams];
+ FrameRingBuffer<NumStreams> shared;
+ FrameRingBuffer<4> perChannel[2];
+ PackedFrameRingBuffer<4, 1> packed[2];
+ shared.setMaximumLength(HistoryLength);
+ for (int c = 0; c < 2; ++c)
+ {
+  perChannel[c].setMaximumLength(HistoryLength);
+  packed[c].setMaximumLength(HistoryLength);
+ }
+ for (int s = 0; s < NumStreams; ++s)
+ {
+  legacy[s].setMaximumLength(static_cast<int>(shared.getSize()));
+  planar[s].setMaximumLength(static_cast<int>(shared.getSize()));
+ }
+
+ // Leave the write index part way through so that ranges wrap
+ std::mt19937 random(1234);
+ std::uniform_real_distribution<float> distribution(-1.f, 1.f);
+ for (int i = 0; i < HistoryLength + HistoryLength/3 + 5; ++i)
+ {
+  float frame[NumStreams];
+  for (int s = 0; s < NumStreams; ++s)
+  {
+   frame[s] = distribution(random);
+   legacy[s].tapIn(frame[s]);
+   planar[s].tapIn(frame[s]);
+  }
+  shared.tapIn(frame);
+  for (int c = 0; c < 2; ++c)
+  {
+   const float channelFrame[4] = {frame[c], frame[2 + c], frame[4 + c], frame[6 + c]};
+   perChannel[c].tapIn(channelFrame);
+   packed[c].tapIn(channelFrame);
+  }
+ }
+
+#if XDLS_REDUCTION_AVX2
+ const char *kernel = "avx2";
+#elif XDLS_REDUCTION_SSE2
+ const char *kernel = "sse2";
+#elif XDLS_REDUCTION_NEON
+ const char *kernel = "neon";
+#else
+ const char *kernel = "scalar";
+#endif
+
+ std::printf("kernel: %s\n", kernel);
+ std::printf("%10s %8s %14s %14s %14s %16s %12s %9s\n",
+             "window", "columns", "legacy (us)", "planar (us)", "shared (us)", "per channel (us)", "packed (us)", "speedup");
+
+ float sink = 0.f;
+ const int windows[] = {4096, 66300, HistoryLength - 1};
+ const int widths[] = {400, 1600, 3840};
+ for (int windowSize : windows)
+ {
+  for (int columns : widths)
+  {
+   auto legacyColumn = [&](int start, int end) { return legacyRange(legacy, Left, start, end); };
+   auto planarColumn = [&](int start, int end) { return planarRange(planar, Left, start, end); };
+   auto sharedColumn = [&](int start, int end) { return interleavedRange(shared, Left, start, end); };
+   auto perChannelColumn = [&](int start, int end) { return interleavedRange(perChannel[0], Channel, start, end); };
+   auto packedColumn = [&](int start, int end) { return interleavedRange(packed[0], Channel, start, end); };
+
+   for (int c = 0; c < columns; ++c)
+   {
+    const int start = static_cast<int>(static_cast<long long>(c)*windowSize/columns);
+    const int end = std::max(static_cast<int>(static_cast<long long>(c + 1)*windowSize/columns), start + 1);
+    const SummaryBin expected = legacyColumn(start, end);
+    if (!sameBin(expected, planarColumn(start, end)) ||
+        !sameBin(expected, sharedColumn(start, end)) ||
+        !sameBin(expected, perChannelColumn(start, end)))
+    {
+     std::printf("Mismatch at window %d column %d\n", windowSize, c);
+     return 1;
+    }
+    // The codes reduce to the code of the reduction
+    if (!sameBin(PackedBin::fromSummary(expected).toSummary(), packedColumn(start, end)))
+    {
+     std::printf("Packed mismatch at window %d column %d\n", windowSize, c);
+     return 1;
+    }
+   }
+
+   const int repeats = std::max(1, 4000000/windowSize);
+   const double legacyTime = timeColumns(legacyColumn, windowSize, columns, repeats, sink);
+   const double planarTime = timeColumns(planarColumn, windowSize, columns, repeats, sink);
+   const double sharedTime = timeColumns(sharedColumn, windowSize, columns, repeats, sink);
+   const double perChannelTime = timeColumns(perChannelColumn, windowSize, columns, repeats, sink);
+   const double packedTime = timeColumns(packedColumn, windowSize, columns, repeats, sink);
+   std::printf("%10d %8d %14.1f %14.1f %14.1f %16.1f %12.1f %8.2fx\n",
+               windowSize, columns, legacyTime*1e6, planarTime*1e6, sharedTime*1e6, perChannelTime*1e6, packedTime*1e6,
+               legacyTime/perChannelTime);
+  }
+ }
+
+ return sink == 12345.f ? 2 : 0;
+}
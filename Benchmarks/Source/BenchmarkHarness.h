@@ -0,0 +1,96 @@
+/*
+ ==============================================================================
+
+ BenchmarkHarness.h
+ Created: 18 Oct 2026 10:14:37am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+ Times a function repeatedly and collects the results as JSON, so that runs
+ from different releases can be compared by a script.
+ */
+class BenchmarkHarness
+{
+ juce::Array<juce::var> results;
+ juce::String filter;
+ double minimumSeconds;
+
+public:
+ BenchmarkHarness(const juce::String &nameFilter, bool quick) :
+ filter(nameFilter),
+ minimumSeconds(quick ? 0.05 : 0.5)
+ {}
+
+ bool wants(const juce::String &name) const
+ { return filter.isEmpty() || name.contains(filter); }
+
+ // Runs function at least a few times and for at least minimumSeconds.
+ // params describes this case, e.g. {"blockSize": 64}. setUp, if given, runs
+ // before each call without being timed.
+ template <typename Function>
+ void run(const juce::String &name,
+          const juce::NamedValueSet &params,
+          Function &&function,
+          std::function<void()> setUp = {})
+ {
+  if (!wants(name)) return;
+
+  std::vector<double> times;
+  double total = 0.;
+  while (times.size() < 5 || total < minimumSeconds)
+  {
+   if (setUp) setUp();
+   const auto start = juce::Time::getHighResolutionTicks();
+   function();
+   const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+   times.push_back(elapsed);
+   total += elapsed;
+  }
+
+  std::sort(times.begin(), times.end());
+  auto nanoseconds = [](double seconds) { return seconds*1e9; };
+  auto percentile = [&](double p) { return times[static_cast<size_t>(p*(times.size() - 1))]; };
+
+  auto *result = new juce::DynamicObject();
+  result->setProperty("benchmark", name);
+  auto *paramObject = new juce::DynamicObject();
+  for (const auto &param: params) paramObject->setProperty(param.name, param.value);
+  result->setProperty("params", juce::var(paramObject));
+  result->setProperty("iterations", static_cast<int>(times.size()));
+  result->setProperty("meanNs", nanoseconds(total/times.size()));
+  result->setProperty("medianNs", nanoseconds(percentile(0.5)));
+  result->setProperty("p99Ns", nanoseconds(percentile(0.99)));
+  result->setProperty("minNs", nanoseconds(times.front()));
+  result->setProperty("maxNs", nanoseconds(times.back()));
+  results.add(juce::var(result));
+
+  juce::String description;
+  for (const auto &param: params) description << " " << param.name.toString() << "=" << param.value.toString();
+  std::cerr << name << description << ": " << juce::String(nanoseconds(percentile(0.5))/1000., 2) << "us median" << std::endl;
+ }
+
+ juce::String toJSON() const
+ {
+  auto *system = new juce::DynamicObject();
+  system->setProperty("os", juce::SystemStats::getOperatingSystemName());
+  system->setProperty("cpu", juce::SystemStats::getCpuModel());
+  system->setProperty("cores", juce::SystemStats::getNumCpus());
+  system->setProperty("juce", juce::SystemStats::getJUCEVersion());
+
+  auto *root = new juce::DynamicObject();
+  root->setProperty("suite", "XDLightScope");
+  root->setProperty("formatVersion", 1);
+  root->setProperty("timestamp", juce::Time::getCurrentTime().toISO8601(true));
+  root->setProperty("system", juce::var(system));
+  root->setProperty("results", juce::var(results));
+  return juce::JSON::toString(juce::var(root));
+ }
+};
@@ -0,0 +1,425 @@
+/*
+ ==============================================================================
+
+ Main.cpp
+ Created: 18 Oct 2026 10:02:55am
+ Author:  Adam Jackson
+
+ Headless benchmarks for the scope data path and rendering. Results are
+ printed to stderr as they run and written as JSON to stdout, or to the
+ file given with --output.
+
+   XDLightScopeBenchmarks [--output results.json] [--filter name] [--quick]
+
+ ==============================================================================
+ */
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/ColouredScope.h"
+#include "../../Source/Crossover.h"
+#include "../../Source/XDDSP/XDDSP.h"
+#include "BenchmarkHarness.h"
+
+namespace
+{
+
+constexpr double SampleRate = 48000.;
+
+void fillWithNoise(juce::AudioBuffer<float> &buffer, juce::Random &random)
+{
+ for (int c = 0; c < buffer.getNumChannels(); ++c)
+ {
+  for (int i = 0; i < buffer.getNumSamples(); ++i) buffer.setSample(c, i, random.nextFloat()*2.f - 1.f);
+ }
+}
+
+// Pushes enough audio through the processor to fill its history
+void fillHistory(XDLightScopeAudioProcessor &processor, int blockSize)
+{
+ juce::AudioBuffer<float> buffer(2, blockSize);
+ juce::MidiBuffer midi;
+ juce::Random random(1);
+ for (unsigned int written = 0; written < processor.leftHistory.getSize(); written += blockSize)
+ {
+  fillWithNoise(buffer, random);
+  processor.processBlock(buffer, midi);
+  processor.drainAnalysisFifo();
+ }
+}
+
+//==============================================================================
+void benchmarkProcessBlock(BenchmarkHarness &harness)
+{
+ for (int channels : {1, 2})
+ {
+  for (int blockSize : {32, 64, 128, 256, 512, 1024})
+  {
+   XDLightScopeAudioProcessor processor;
+   auto layout = channels == 1 ? juce::AudioChannelSet::mono() : juce::AudioChannelSet::stereo();
+   juce::AudioProcessor::BusesLayout buses;
+   buses.inputBuses.add(layout);
+   buses.outputBuses.add(layout);
+   processor.setBusesLayout(buses);
+   processor.prepareToPlay(SampleRate, blockSize);
+
+   juce::AudioBuffer<float> buffer(channels, blockSize);
+   juce::MidiBuffer midi;
+   juce::Random random(1);
+   fillWithNoise(buffer, random);
+
+   // Keep the FIFO from filling up without timing the drain
+   int blocksSinceDrain = 0;
+   harness.run("processBlock", {{"blockSize", blockSize}, {"channels", channels}},
+               [&]() { processor.processBlock(buffer, midi); },
+               [&]()
+   {
+    if (++blocksSinceDrain*blockSize > 8192)
+    {
+     processor.drainAnalysisFifo();
+     blocksSinceDrain = 0;
+    }
+   });
+   processor.releaseResources();
+  }
+ }
+}
+
+// The crossover as it was before Crossover.h, a pair of XDDSP Butterworth
+// low passes with the bands taken by subtraction
+void benchmarkBiquadPair(BenchmarkHarness &harness, int channels, int blockSize, const std::vector<float> &input)
+{
+ XDDSP::Parameters dspParam;
+ dspParam.setSampleRate(SampleRate);
+ XDDSP::BiquadFilterCoefficients lowCoeff(dspParam);
+ XDDSP::BiquadFilterCoefficients highCoeff(dspParam);
+ lowCoeff.setLowPassFilter(LowXOver, 0.707);
+ highCoeff.setLowPassFilter(HighXOver, 0.707);
+ std::vector<XDDSP::BiquadFilterKernel> lowLP(channels);
+ std::vector<XDDSP::BiquadFilterKernel> highLP(channels);
+ std::vector<float> output(3*channels*blockSize);
+
+ harness.run("crossover", {{"engine", "biquadPair"}, {"bands", 3}, {"channels", channels}, {"blockSize", blockSize}}, [&]()
+ {
+  for (int c = 0; c < channels; ++c)
+  {
+   const float *in = input.data() + c*blockSize;
+   float *bass = output.data() + (3*c)*blockSize;
+   float *mids = bass + blockSize;
+   float *high = mids + blockSize;
+   for (int i = 0; i < blockSize; ++i)
+   {
+    bass[i] = lowLP[c].process(lowCoeff, in[i]);
+    const float rest = in[i] - bass[i];
+    mids[i] = highLP[c].process(highCoeff, rest);
+    high[i] = rest - mids[i];
+   }
+  }
+ });
+}
+
+template <int Order, int NumBands, int Lanes>
+void benchmarkCrossoverEngine(BenchmarkHarness &harness, int blockSize, const std::vector<float> &input)
+{
+ Crossover<Order, NumBands, Lanes> crossover;
+ crossover.setSampleRate(SampleRate);
+ std::vector<float> output(NumBands*Lanes*blockSize);
+ const float *in[Lanes];
+ float *out[NumBands*Lanes];
+ for (int l = 0; l < Lanes; ++l) in[l] = input.data() + l*blockSize;
+ for (int b = 0; b < NumBands*Lanes; ++b) out[b] = output.data() + b*blockSize;
+
+ harness.run("crossover", {{"engine", "LR" + juce::String(Order)}, {"bands", NumBands}, {"channels", Lanes}, {"blockSize", blockSize}},
+             [&]() { crossover.process(in, out, blockSize); });
+}
+
+void benchmarkCrossover(BenchmarkHarness &harness)
+{
+ for (int blockSize : {32, 64, 512})
+ {
+  std::vector<float> input(2*blockSize);
+  juce::Random random(5);
+  for (auto &sample: input) sample = random.nextFloat()*2.f - 1.f;
+
+  for (int channels : {1, 2}) benchmarkBiquadPair(harness, channels, blockSize, input);
+  benchmarkCrossoverEngine<2, 3, 1>(harness, blockSize, input);
+  benchmarkCrossoverEngine<4, 3, 1>(harness, blockSize, input);
+  benchmarkCrossoverEngine<8, 3, 1>(harness, blockSize, input);
+  benchmarkCrossoverEngine<4, 3, 2>(harness, blockSize, input);
+  benchmarkCrossoverEngine<4, 5, 2>(harness, blockSize, input);
+ }
+}
+
+void benchmarkGetRange(BenchmarkHarness &harness)
+{
+ XDLightScopeAudioProcessor processor;
+ processor.prepareToPlay(SampleRate, 512);
+ fillHistory(processor, 512);
+
+ CircularBufferSource<decltype(processor.leftHistory), decltype(processor.leftSummary)> source(processor.leftHistory,
+                                                                                               XDLightScopeAudioProcessor::WaveStream,
+                                                                                               XDLightScopeAudioProcessor::BassStream,
+                                                                                               XDLightScopeAudioProcessor::MidsStream,
+                                                                                               XDLightScopeAudioProcessor::HighStream);
+
+ for (bool useSummary : {false, true})
+ {
+  source.setSummary(useSummary ? &processor.leftSummary : nullptr);
+  std::vector<int> windowSizes {4096, 66300, 220000};
+  // Ten minutes and an hour, which only the summary's long history reaches
+  if (useSummary) windowSizes.insert(windowSizes.end(), {static_cast<int>(SampleRate*600.), static_cast<int>(SampleRate*3600.)});
+  for (int windowSize : windowSizes)
+  {
+   for (int columns : {400, 1600, 3840})
+   {
+    source.setWindowSize(windowSize);
+    float sink = 0.f;
+    harness.run("getRange", {{"window", windowSize}, {"columns", columns}, {"summary", useSummary}}, [&]()
+    {
+     for (int c = 0; c < columns; ++c)
+     {
+      const int start = static_cast<int>(static_cast<juce::int64>(c)*windowSize/columns);
+      const int end = static_cast<int>(static_cast<juce::int64>(c + 1)*windowSize/columns);
+      sink += source.getRange(start, end).max;
+     }
+    });
+
+    // The same columns through the batched interface, colours included
+    std::vector<ScopeDataSource::ColumnRange> ranges(static_cast<size_t>(columns));
+    std::vector<SummaryBin> bins(ranges.size());
+    std::vector<juce::PixelARGB> pixels(ranges.size());
+    const auto palette = ColourPalette::classic();
+    for (int c = 0; c < columns; ++c)
+    {
+     ranges[c] = {static_cast<int>(static_cast<juce::int64>(c)*windowSize/columns),
+                  static_cast<int>(static_cast<juce::int64>(c + 1)*windowSize/columns)};
+    }
+    harness.run("getColumns", {{"window", windowSize}, {"columns", columns}, {"summary", useSummary}}, [&]()
+    {
+     source.getColumns(ranges.data(), columns, bins.data());
+     palette.translate(bins.data(), columns, source.defaultColour, pixels.data());
+     sink += bins[0].max;
+    });
+    juce::ignoreUnused(sink);
+   }
+  }
+ }
+}
+
+void benchmarkScopeUpdate(BenchmarkHarness &harness)
+{
+ XDLightScopeAudioProcessor processor;
+ processor.prepareToPlay(SampleRate, 512);
+ fillHistory(processor, 512);
+
+ CircularBufferSource<decltype(processor.leftHistory), decltype(processor.leftSummary)> source(processor.leftHistory,
+                                                                                               XDLightScopeAudioProcessor::WaveStream,
+                                                                                               XDLightScopeAudioProcessor::BassStream,
+                                                                                               XDLightScopeAudioProcessor::MidsStream,
+                                                                                               XDLightScopeAudioProcessor::HighStream);
+ source.setSummary(&processor.leftSummary);
+ source.setWindowSize(XDLightScopeAudioProcessor::DefaultWindowSize);
+
+ juce::AudioBuffer<float> block(2, 512);
+ juce::MidiBuffer midi;
+ juce::Random random(2);
+ fillWithNoise(block, random);
+
+ using RenderMode = ColouredScope::RenderMode;
+ for (auto mode : {RenderMode::path, RenderMode::spans})
+ {
+  for (bool incremental : {false, true})
+  {
+   for (int width : {400, 1600, 3840})
+   {
+    for (float scale : {1.f, 2.f})
+    {
+     ColouredScope scope;
+     scope.source = &source;
+     scope.strokeEnable = true;
+     scope.incrementalEnable = incremental;
+     scope.renderMode = mode;
+     scope.setBounds(0, 0, width, 80);
+
+     // Painting once through a scaled context is how the scope learns the
+     // display's scale factor
+     juce::Image canvas(juce::Image::ARGB, static_cast<int>(width*scale), static_cast<int>(80*scale), true);
+     {
+      juce::Graphics g(canvas);
+      g.addTransform(juce::AffineTransform::scale(scale));
+      scope.paint(g);
+     }
+
+     // One audio block arrives between frames, as it would at 30Hz or more
+     juce::NamedValueSet params {{"width", width}, {"scale", scale}, {"incremental", incremental},
+                                 {"renderMode", mode == RenderMode::spans ? "spans" : "path"}};
+     auto newAudio = [&]()
+     {
+      processor.processBlock(block, midi);
+      processor.drainAnalysisFifo();
+     };
+     harness.run("scopeUpdate", params, [&]() { scope.update(); }, newAudio);
+     harness.run("scopePaint", params, [&]()
+     {
+      juce::Graphics g(canvas);
+      g.addTransform(juce::AffineTransform::scale(scale));
+      scope.paint(g);
+     }, [&]() { newAudio(); scope.update(); });
+    }
+   }
+  }
+ }
+}
+
+//==============================================================================
+juce::File writeTestFile(const juce::File &directory, double seconds)
+{
+ auto file = directory.getChildFile("benchmark-" + juce::String(static_cast<int>(seconds)) + "s.wav");
+ if (file.existsAsFile()) return file;
+
+ juce::WavAudioFormat wav;
+ std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(new juce::FileOutputStream(file),
+                                                                     SampleRate, 2, 16, {}, 0));
+ if (!writer) return {};
+
+ juce::AudioBuffer<float> buffer(2, 4096);
+ juce::Random random(3);
+ for (juce::int64 written = 0; written < static_cast<juce::int64>(seconds*SampleRate); written += buffer.getNumSamples())
+ {
+  for (int i = 0; i < buffer.getNumSamples(); ++i)
+  {
+   const double t = (written + i)/SampleRate;
+   const float sample = 0.4f*std::sin(juce::MathConstants<double>::twoPi*55.*t)
+   + 0.2f*std::sin(juce::MathConstants<double>::twoPi*1000.*t)
+   + 0.1f*(random.nextFloat()*2.f - 1.f);
+   buffer.setSample(0, i, sample);
+   buffer.setSample(1, i, sample);
+  }
+  writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+ }
+ return file;
+}
+
+void benchmarkAudioFile(BenchmarkHarness &harness, const juce::File &workDirectory)
+{
+ const auto file = writeTestFile(workDirectory, 180.);
+ if (file == juce::File()) return;
+ const auto overviews = workDirectory.getChildFile("Overviews");
+ constexpr int Columns = 1600;
+
+ // Seeking happens on the source's worker thread, so each measurement waits
+ // for the new window to be published before drawing it
+ auto drawFrame = [](AudioFileScopeSource &source)
+ {
+  float sink = 0.f;
+  const int windowSize = static_cast<int>(source.getRangeSize());
+  for (int c = 0; c < Columns; ++c)
+  {
+   sink += source.getRange(static_cast<int>(static_cast<juce::int64>(c)*windowSize/Columns),
+                           static_cast<int>(static_cast<juce::int64>(c + 1)*windowSize/Columns)).max;
+  }
+  return sink;
+ };
+
+ // A cold open is dominated by building the overview, which happens in the
+ // background on the shared analysis pool
+ const auto fingerprint = WaveformOverview::fingerprint(file, LowXOver, HighXOver);
+ const auto overviewFile = WaveformOverview::getCacheFile(file, fingerprint, overviews);
+ juce::SharedResourcePointer<ParallelAnalyser::Pool> analysisPool;
+ for (bool parallel : {false, true})
+ {
+  harness.run("overviewBuild", {{"seconds", 180}, {"parallel", parallel}}, [&]()
+  {
+   WaveformOverview::build(parallel ? &analysisPool->pool : nullptr,
+                           ParallelAnalyser::readerFactoryFor(file),
+                           LowXOver, HighXOver, fingerprint, overviewFile,
+                           []() { return false; });
+  });
+ }
+
+ harness.run("audioFileOpen", {{"overview", "warm"}}, [&]()
+ {
+  AudioFileScopeSource source;
+  source.setOverviewDirectory(overviews);
+  source.openFile(file.getFullPathName());
+  source.setColumnCount(Columns);
+  source.setWindowSize(static_cast<int>(60.*SampleRate));
+  source.waitForView(10000);
+  drawFrame(source);
+ });
+
+ for (double windowSeconds : {1., 10., 60.})
+ {
+  AudioFileScopeSource source;
+  source.setOverviewDirectory(overviews);
+  source.openFile(file.getFullPathName());
+  source.setColumnCount(Columns);
+  source.setWindowSize(static_cast<int>(windowSeconds*SampleRate));
+
+  juce::Random random(4);
+  const juce::int64 range = source.getFileLength() - static_cast<juce::int64>(windowSeconds*SampleRate);
+  harness.run("audioFileSeek", {{"windowSeconds", windowSeconds}, {"columns", Columns}},
+              [&]() { source.waitForView(10000); drawFrame(source); },
+              [&]() { source.setOffset(static_cast<long>(random.nextDouble()*static_cast<double>(range))); });
+ }
+
+ // Following a play head, where each frame moves the window on by a frame's
+ // worth of samples and most of the window can be reused
+ for (double windowSeconds : {1., 10.})
+ {
+  AudioFileScopeSource source;
+  source.setOverviewDirectory(overviews);
+  source.openFile(file.getFullPathName());
+  source.setColumnCount(Columns);
+  source.setWindowSize(static_cast<int>(windowSeconds*SampleRate));
+
+  long offset = 0;
+  harness.run("audioFileScroll", {{"windowSeconds", windowSeconds}, {"columns", Columns}},
+              [&]() { source.waitForView(10000); drawFrame(source); },
+              [&]() { offset += static_cast<long>(SampleRate/60.); source.setOffset(offset); });
+ }
+}
+
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+ juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+ juce::String filter;
+ juce::File output;
+ bool quick {false};
+ for (int i = 1; i < argc; ++i)
+ {
+  const juce::String arg(argv[i]);
+  if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+  else if (arg == "--output" && i + 1 < argc) output = juce::File::getCurrentWorkingDirectory().getChildFile(argv[++i]);
+  else if (arg == "--quick") quick = true;
+  else
+  {
+   std::cerr << "Usage: XDLightScopeBenchmarks [--output results.json] [--filter name] [--quick]" << std::endl;
+   return 1;
+  }
+ }
+
+ const auto workDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("XDLightScopeBenchmarks");
+ workDirectory.createDirectory();
+
+ BenchmarkHarness harness(filter, quick);
+ benchmarkProcessBlock(harness);
+ benchmarkCrossover(harness);
+ benchmarkGetRange(harness);
+ benchmarkScopeUpdate(harness);
+ benchmarkAudioFile(harness, workDirectory);
+
+ const auto json = harness.toJSON();
+ if (output == juce::File()) std::cout << json << std::endl;
+ else if (!output.replaceWithText(json))
+ {
+  std::cerr << "Couldn't write " << output.getFullPathName() << std::endl;
+  return 1;
+ }
+
+ return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ ==============================================================================
+
+ AnalysisFifo.h
+ Created: 16 Oct 2026 9:12:05am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+/*
+ Wait-free single producer/single consumer FIFO which carries the analysis
+ streams from the audio thread to the message thread. The streams are stored
+ planar, so each end sees at most two contiguous segments per transfer.
+
+ The producer never blocks. If the consumer falls behind, the samples which
+ do not fit are dropped and counted instead.
+ */
+template <int NumStreams>
+class AnalysisFifo
+{
+ juce::AbstractFifo fifo;
+ std::array<std::vector<float>, NumStreams> streams;
+
+ std::atomic<int> highWater {0};
+ std::atomic<unsigned int> droppedSamples {0};
+
+ template <typename Function>
+ static void forEachSegment(int start1, int size1, int start2, int size2,
+                            std::array<std::vector<float>, NumStreams> &data,
+                            Function &&function)
+ {
+  std::array<float*, NumStreams> pointers;
+
+  if (size1 > 0)
+  {
+   for (int s = 0; s < NumStreams; ++s) pointers[s] = data[s].data() + start1;
+   function(pointers.data(), 0, size1);
+  }
+
+  if (size2 > 0)
+  {
+   for (int s = 0; s < NumStreams; ++s) pointers[s] = data[s].data() + start2;
+   function(pointers.data(), size1, size2);
+  }
+ }
+
+public:
+ AnalysisFifo(int capacity) :
+ fifo(capacity)
+ {
+  for (auto &s: streams) s.resize(capacity);
+ }
+
+ // Audio thread only. The writer is called as writer(streamPointers, offset,
+ // count) for each contiguous segment, where offset counts from the start of
+ // the samples being written. Returns the number of samples accepted.
+ template <typename Writer>
+ int write(int numSamples, Writer &&writer)
+ {
+  int start1, size1, start2, size2;
+  fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+  forEachSegment(start1, size1, start2, size2, streams, writer);
+
+  const int written = size1 + size2;
+  fifo.finishedWrite(written);
+
+  if (written < numSamples)
+  {
+   droppedSamples.fetch_add(static_cast<unsigned int>(numSamples - written),
+                            std::memory_order_relaxed);
+  }
+
+  const int ready = fifo.getNumReady();
+  if (ready > highWater.load(std::memory_order_relaxed))
+  {
+   highWater.store(ready, std::memory_order_relaxed);
+  }
+
+  return written;
+ }
+
+ // Consumer thread only. The reader is called as reader(streamPointers,
+ // offset, count) for each contiguous segment of ready samples.
+ template <typename Reader>
+ int read(Reader &&reader)
+ {
+  int start1, size1, start2, size2;
+  fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+  forEachSegment(start1, size1, start2, size2, streams, reader);
+
+  const int numRead = size1 + size2;
+  fifo.finishedRead(numRead);
+  return numRead;
+ }
+
+ int getCapacity() const
+ { return fifo.getTotalSize() - 1; }
+
+ // The following may be called from any thread. The take* functions reset
+ // the counter they return.
+ int getNumReady() const
+ { return fifo.getNumReady(); }
+
+ int takeHighWater()
+ { return highWater.exchange(0, std::memory_order_relaxed); }
+
+ unsigned int takeDroppedSamples()
+ { return droppedSamples.exchange(0, std::memory_order_relaxed); }
+};
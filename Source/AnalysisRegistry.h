@@ -0,0 +1,148 @@
+/*
+ ==============================================================================
+
+ AnalysisRegistry.h
+ Created: 19 Oct 2026 4:05:26pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+class ScopeDataSource;
+
+//==============================================================================
+/*
+ Every scope instance in the process registers here, through a
+ SharedResourcePointer. Editors and meter bridges call drain() from their
+ FramePacer before they draw a frame. However many of them are open, the
+ instances are drained at most once per display frame, by whichever asks
+ first. While any instance is registered a timer drains them too, so their
+ histories keep recording when no editor is open.
+
+ Instances and listeners are expected to come and go on the message thread,
+ which is where JUCE creates and deletes processors and editors. Histories
+ are only written, and resized, on the message thread while draining, with
+ the history lock held, so a thread other than the message thread can read
+ them by holding it too.
+ */
+class AnalysisRegistry : private juce::AsyncUpdater, private juce::Timer
+{
+public:
+ class Instance
+ {
+ public:
+  virtual ~Instance() = default;
+  
+  // Called on the message thread by drain()
+  virtual void drainAnalysis() = 0;
+  
+  // The host's name for the track, or empty if it hasn't said
+  virtual juce::String getInstanceName() const = 0;
+  
+  // A source reading channel 0 (left) or 1 (right) of the instance's
+  // history. It must be deleted before the instance is removed.
+  virtual std::unique_ptr<ScopeDataSource> createScopeSource(int channel) = 0;
+ };
+ 
+ class Listener
+ {
+ public:
+  virtual ~Listener() = default;
+  
+  // Instances were added, removed or renamed. Removal is announced before
+  // the instance goes away, so sources created from it can be dropped.
+  virtual void instancesChanged() = 0;
+ };
+ 
+ // Drains closer together than this are taken to be for the same frame,
+ // which leaves room for displays up to 240Hz
+ static constexpr double MinimumDrainInterval = 0.004;
+ 
+ // How often the timer drains, well inside the time it takes an instance's
+ // FIFO to fill even at high sample rates
+ static constexpr int BackgroundDrainInterval = 100;
+ 
+ ~AnalysisRegistry() override
+ {
+  stopTimer();
+  cancelPendingUpdate();
+ }
+ 
+ void addInstance(Instance *instance)
+ {
+  {
+   const juce::ScopedLock sl(lock);
+   instances.addIfNotAlreadyThere(instance);
+  }
+  if (!isTimerRunning()) startTimer(BackgroundDrainInterval);
+  notifyInstancesChanged();
+ }
+ 
+ void removeInstance(Instance *instance)
+ {
+  {
+   const juce::ScopedLock sl(lock);
+   instances.removeFirstMatchingValue(instance);
+   if (instances.isEmpty()) stopTimer();
+  }
+  notifyInstancesChanged();
+ }
+ 
+ // Call when an instance's name changes, from any thread
+ void instanceRenamed()
+ { triggerAsyncUpdate(); }
+ 
+ juce::Array<Instance*> getInstances() const
+ {
+  const juce::ScopedLock sl(lock);
+  return instances;
+ }
+ 
+ void addListener(Listener *listener)
+ { listeners.add(listener); }
+ 
+ void removeListener(Listener *listener)
+ { listeners.remove(listener); }
+ 
+ // Held while the instances are drained. Keep it no longer than it takes to
+ // read a history, as drain() waits for it on the message thread.
+ const juce::CriticalSection &getHistoryLock() const
+ { return lock; }
+ 
+ // Drains every instance, unless that was already done for this frame.
+ // Call on the message thread.
+ void drain()
+ {
+  const double now = juce::Time::getMillisecondCounterHiRes()*0.001;
+  if (now - lastDrain < MinimumDrainInterval) return;
+  lastDrain = now;
+  
+  const juce::ScopedLock sl(lock);
+  for (auto *instance: instances) instance->drainAnalysis();
+ }
+ 
+private:
+ juce::CriticalSection lock;
+ juce::Array<Instance*> instances;
+ juce::ListenerList<Listener> listeners;
+ double lastDrain {-1.};
+
+ void notifyInstancesChanged()
+ {
+  if (juce::MessageManager::existsAndIsCurrentThread())
+  {
+   listeners.call([](Listener &l) { l.instancesChanged(); });
+  }
+  else triggerAsyncUpdate();
+ }
+ 
+ void handleAsyncUpdate() override
+ { listeners.call([](Listener &l) { l.instancesChanged(); }); }
+ 
+ void timerCallback() override
+ { drain(); }
+};
@@ -0,0 +1,71 @@
+/*
+ ==============================================================================
+
+ BandSplitter.h
+ Created: 17 Oct 2026 9:02:16am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include "Crossover.h"
+
+//==============================================================================
+/*
+ The three band crossover used to colour the scopes, an LR4 Crossover on a
+ single channel with a named interface.
+ */
+class BandSplitter
+{
+ Crossover<4, 3> crossover;
+
+public:
+ BandSplitter()
+ {
+  setCrossovers(LowXOver, HighXOver);
+ }
+
+ void setSampleRate(double newSampleRate)
+ { crossover.setSampleRate(newSampleRate); }
+ 
+ double getSampleRate() const
+ { return crossover.getSampleRate(); }
+
+ void setCrossovers(float low, float high)
+ {
+  crossover.setCrossovers(low, high);
+ }
+
+ float getLowCrossover() const
+ { return crossover.getCrossover(0); }
+
+ float getHighCrossover() const
+ { return crossover.getCrossover(1); }
+
+ // How many samples it takes for the slowest filter to forget its state to
+ // within the given tolerance. Running this many samples ahead of a chunk
+ // makes its bands match a pass over the whole file.
+ int getSettlingSamples(double tolerance = 1e-5) const
+ { return crossover.getSettlingSamples(tolerance); }
+ 
+ void reset()
+ { crossover.reset(); }
+
+ void split(float sample, float &bass, float &mids, float &high)
+ {
+  const float input[1] = {sample};
+  float bands[3][1];
+  crossover.split(input, bands);
+  bass = bands[0][0];
+  mids = bands[1][0];
+  high = bands[2][0];
+ }
+
+ void process(const float *input, float *bass, float *mids, float *high, int numSamples)
+ {
+  float *const bands[3] = {bass, mids, high};
+  crossover.process(&input, bands, numSamples);
+ }
+};
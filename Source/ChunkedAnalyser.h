@@ -0,0 +1,364 @@
+/*
+ ==============================================================================
+
+ ChunkedAnalyser.h
+ Created: 17 Oct 2026 1:26:09pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BandSplitter.h"
+#include "ScopeReduction.h"
+
+//==============================================================================
+/*
+ Streams a range of an audio file through the crossover in fixed size chunks
+ and folds each chunk straight into SummaryBins, so the memory used depends
+ on the number of bins and not on the length of the range.
+
+ Bins are aligned to the absolute sample position: bin b covers the samples
+ [b << binShift, (b + 1) << binShift) of the file.
+ */
+class ChunkedAnalyser
+{
+ juce::AudioBuffer<float> chunk;
+ std::vector<float> mono;
+ std::vector<float> bass;
+ std::vector<float> mids;
+ std::vector<float> high;
+
+ // Mixes count samples from position on into mono
+ const float *readChunk(juce::AudioFormatReader &reader, juce::int64 position, int count)
+ {
+  reader.read(&chunk, 0, count, position, true, true);
+  const float *left = chunk.getReadPointer(0);
+  const float *right = chunk.getReadPointer(1);
+  for (int i = 0; i < count; ++i) mono[i] = 0.5f*(left[i] + right[i]);
+  return mono.data();
+ }
+
+ // Points straight into samples where it can, and copies into mono with
+ // zeros past either end of the samples where it can't
+ const float *mapChunk(const float *samples, juce::int64 numSamples, juce::int64 position, int count)
+ {
+  if (position >= 0 && position + count <= numSamples) return samples + position;
+  for (int i = 0; i < count; ++i)
+  {
+   const juce::int64 sample = position + i;
+   mono[i] = sample >= 0 && sample < numSamples ? samples[sample] : 0.f;
+  }
+  return mono.data();
+ }
+
+ // fetch(position, count) returns the mono samples [position, position + count).
+ // The splitter carries on from whatever state it is in.
+ template <typename Fetch, typename ShouldExit>
+ bool analyseChunks(Fetch &&fetch,
+                    BandSplitter &splitter,
+                    juce::int64 start,
+                    juce::int64 length,
+                    int leadIn,
+                    int binShift,
+                    juce::int64 binOrigin,
+                    SummaryBin *bins,
+                    ShouldExit &&shouldExit)
+ {
+  for (juce::int64 position = start - leadIn; position < start; )
+  {
+   const int count = static_cast<int>(std::min<juce::int64>(ChunkSize, start - position));
+   splitter.process(fetch(position, count), bass.data(), mids.data(), high.data(), count);
+   position += count;
+  }
+
+  const juce::int64 end = start + length;
+  const juce::int64 binMask = (juce::int64(1) << binShift) - 1;
+  for (juce::int64 position = start; position < end; )
+  {
+   if (shouldExit()) return false;
+
+   const int count = static_cast<int>(std::min<juce::int64>(ChunkSize, end - position));
+   const float *wave = fetch(position, count);
+   splitter.process(wave, bass.data(), mids.data(), high.data(), count);
+   for (int i = 0; i < count; )
+   {
+    const juce::int64 sample = position + i;
+    const int run = static_cast<int>(std::min<juce::int64>(count - i, (binMask + 1) - (sample & binMask)));
+    SummaryBin &bin = bins[(sample >> binShift) - binOrigin];
+    if ((sample & binMask) == 0) bin = ScopeReduction::reduce(wave + i, bass.data() + i, mids.data() + i, high.data() + i, run);
+    else ScopeReduction::reduceSpan(wave + i, bass.data() + i, mids.data() + i, high.data() + i, run, bin);
+    i += run;
+   }
+   position += count;
+  }
+
+  return true;
+ }
+
+public:
+ static constexpr int ChunkSize = 1 << 14;
+
+ ChunkedAnalyser() :
+ chunk(2, ChunkSize),
+ mono(ChunkSize),
+ bass(ChunkSize),
+ mids(ChunkSize),
+ high(ChunkSize)
+ {}
+
+ // Analyses the samples [start, start + length) into bins, where bins[0] is
+ // absolute bin binOrigin. The splitter is reset and run over leadIn samples
+ // before start to settle the filters. A bin which is only partly covered
+ // by the range is merged with what bins already holds when the range
+ // starts part way into it, and overwritten otherwise.
+ // Returns false if shouldExit() returned true before the range was done.
+ template <typename ShouldExit>
+ bool analyse(juce::AudioFormatReader &reader,
+              BandSplitter &splitter,
+              juce::int64 start,
+              juce::int64 length,
+              int leadIn,
+              int binShift,
+              juce::int64 binOrigin,
+              SummaryBin *bins,
+              ShouldExit &&shouldExit)
+ {
+  splitter.reset();
+  return analyseChunks([&](juce::int64 position, int count) { return readChunk(reader, position, count); },
+                       splitter, start, length, leadIn, binShift, binOrigin, bins, shouldExit);
+ }
+
+ // The same, reading a mono mix which is already in memory, such as a
+ // mapped DecodedAudioCache, without copying it
+ template <typename ShouldExit>
+ bool analyse(const float *monoSamples,
+              juce::int64 numSamples,
+              BandSplitter &splitter,
+              juce::int64 start,
+              juce::int64 length,
+              int leadIn,
+              int binShift,
+              juce::int64 binOrigin,
+              SummaryBin *bins,
+              ShouldExit &&shouldExit)
+ {
+  splitter.reset();
+  return analyseChunks([&](juce::int64 position, int count) { return mapChunk(monoSamples, numSamples, position, count); },
+                       splitter, start, length, leadIn, binShift, binOrigin, bins, shouldExit);
+ }
+ 
+ // Like analyse, but without resetting the splitter or running a lead in.
+ // The splitter must have just analysed the samples up to start, so its
+ // filters carry straight on from there.
+ template <typename ShouldExit>
+ bool resume(juce::AudioFormatReader &reader,
+             BandSplitter &splitter,
+             juce::int64 start,
+             juce::int64 length,
+             int binShift,
+             juce::int64 binOrigin,
+             SummaryBin *bins,
+             ShouldExit &&shouldExit)
+ {
+  return analyseChunks([&](juce::int64 position, int count) { return readChunk(reader, position, count); },
+                       splitter, start, length, 0, binShift, binOrigin, bins, shouldExit);
+ }
+ 
+ template <typename ShouldExit>
+ bool resume(const float *monoSamples,
+             juce::int64 numSamples,
+             BandSplitter &splitter,
+             juce::int64 start,
+             juce::int64 length,
+             int binShift,
+             juce::int64 binOrigin,
+             SummaryBin *bins,
+             ShouldExit &&shouldExit)
+ {
+  return analyseChunks([&](juce::int64 position, int count) { return mapChunk(monoSamples, numSamples, position, count); },
+                       splitter, start, length, 0, binShift, binOrigin, bins, shouldExit);
+ }
+};
+
+
+
+
+
+
+
+
+
+
+//==============================================================================
+/*
+ Splits a range into segments which are analysed at the same time on a
+ thread pool. Each segment gets its own reader, crossover and
+ ChunkedAnalyser and is seeded with the crossover's settling time worth of
+ lead in, so the bands at segment boundaries match a single pass.
+ Boundaries between segments fall on bin boundaries, so no two segments
+ ever write the same bin.
+ */
+class ParallelAnalyser
+{
+ // Splits [start, start + length) into segments with boundaries on whole
+ // bins, and calls analyseSegment(analyser, splitter, segmentStart,
+ // segmentLength, shouldExit) for each one, one of them on the calling
+ // thread
+ template <typename AnalyseSegment, typename ShouldExit>
+ static bool analyseSegments(juce::ThreadPool *pool,
+                             const BandSplitter &splitter,
+                             juce::int64 start,
+                             juce::int64 length,
+                             int binShift,
+                             AnalyseSegment &&analyseSegment,
+                             ShouldExit &&shouldExit)
+ {
+  const juce::int64 binSize = juce::int64(1) << binShift;
+  const int maxSegments = pool == nullptr ? 1 : juce::jlimit(1, 4*pool->getNumThreads(), static_cast<int>(length / MinimumSegment));
+  
+  // Round the boundaries up to whole bins
+  std::vector<juce::int64> boundaries {start};
+  for (int s = 1; s < maxSegments; ++s)
+  {
+   const juce::int64 boundary = ((start + length*s/maxSegments + binSize - 1) >> binShift) << binShift;
+   if (boundary > boundaries.back() && boundary < start + length) boundaries.push_back(boundary);
+  }
+  boundaries.push_back(start + length);
+  const int numSegments = static_cast<int>(boundaries.size()) - 1;
+  
+  std::atomic<int> remaining {numSegments};
+  std::atomic<bool> failed {false};
+  juce::WaitableEvent done;
+  
+  auto runSegment = [&](int segment)
+  {
+   BandSplitter segmentSplitter;
+   segmentSplitter.setSampleRate(splitter.getSampleRate());
+   segmentSplitter.setCrossovers(splitter.getLowCrossover(), splitter.getHighCrossover());
+   ChunkedAnalyser analyser;
+   if (!analyseSegment(analyser, segmentSplitter,
+                       boundaries[segment],
+                       boundaries[segment + 1] - boundaries[segment],
+                       [&]() { return failed.load() || shouldExit(); })) failed = true;
+   
+   if (--remaining == 0) done.signal();
+  };
+  
+  for (int s = 1; s < numSegments; ++s) pool->addJob([&runSegment, s]() { runSegment(s); });
+  runSegment(0);
+  done.wait();
+  
+  return !failed;
+ }
+ 
+public:
+ // Readers aren't thread safe, so every segment asks for its own
+ using ReaderFactory = std::function<std::unique_ptr<juce::AudioFormatReader>()>;
+ 
+ // Uncompressed formats which JUCE can map, WAV and AIFF, are read straight
+ // from a memory mapped file, so reading costs page faults rather than
+ // system calls. Anything else gets the format's ordinary reader.
+ static std::unique_ptr<juce::AudioFormatReader> createReaderFor(const juce::File &file)
+ {
+  juce::AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+  if (auto *format = formatManager.findFormatForFileExtension(file.getFileExtension()))
+  {
+   std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+   if (mapped && mapped->mapEntireFile()) return mapped;
+  }
+  return std::unique_ptr<juce::AudioFormatReader>(formatManager.createReaderFor(file));
+ }
+ 
+ static ReaderFactory readerFactoryFor(const juce::File &file)
+ {
+  return [file]() { return createReaderFor(file); };
+ }
+ 
+ // Identifies a file by its size, modification time and first and last
+ // 64kB, along with whatever settings the caller's results depend on, so
+ // files made from it can be checked for staleness without reading it all
+ static juce::MD5 fingerprint(const juce::File &file, const juce::MemoryBlock &settings)
+ {
+  static constexpr int SampleBytes = 1 << 16;
+  
+  juce::MemoryOutputStream data;
+  data.writeInt64(file.getSize());
+  data.writeInt64(file.getLastModificationTime().toMilliseconds());
+  data << settings;
+  
+  juce::FileInputStream in(file);
+  if (in.openedOk())
+  {
+   data.writeFromInputStream(in, SampleBytes);
+   if (in.getTotalLength() > 2*SampleBytes)
+   {
+    in.setPosition(in.getTotalLength() - SampleBytes);
+    data.writeFromInputStream(in, SampleBytes);
+   }
+  }
+  
+  return juce::MD5(data.getMemoryBlock());
+ }
+ 
+ static constexpr juce::int64 MinimumSegment = 1 << 18;
+ 
+ // Shared by everything in the process which analyses files
+ struct Pool
+ {
+  juce::ThreadPool pool {juce::jmax(1, juce::SystemStats::getNumCpus())};
+ };
+ 
+ // Same contract as ChunkedAnalyser::analyse, with the crossover settings
+ // copied from splitter. Blocks until every segment is done, and analyses
+ // one of the segments on the calling thread. Without a pool the whole
+ // range is analysed on the calling thread.
+ template <typename ShouldExit>
+ static bool analyse(juce::ThreadPool *pool,
+                     const ReaderFactory &createReader,
+                     const BandSplitter &splitter,
+                     juce::int64 start,
+                     juce::int64 length,
+                     int binShift,
+                     juce::int64 binOrigin,
+                     SummaryBin *bins,
+                     ShouldExit &&shouldExit)
+ {
+  return analyseSegments(pool, splitter, start, length, binShift,
+                         [&](ChunkedAnalyser &analyser, BandSplitter &segmentSplitter,
+                             juce::int64 segmentStart, juce::int64 segmentLength, auto &&segmentShouldExit)
+  {
+   auto reader = createReader();
+   return reader != nullptr && analyser.analyse(*reader, segmentSplitter, segmentStart, segmentLength,
+                                                segmentSplitter.getSettlingSamples(),
+                                                binShift, binOrigin, bins, segmentShouldExit);
+  }, shouldExit);
+ }
+ 
+ // The same, over a mono mix which is already in memory. The segments share
+ // it, so nothing is read or copied.
+ template <typename ShouldExit>
+ static bool analyse(juce::ThreadPool *pool,
+                     const float *monoSamples,
+                     juce::int64 numSamples,
+                     const BandSplitter &splitter,
+                     juce::int64 start,
+                     juce::int64 length,
+                     int binShift,
+                     juce::int64 binOrigin,
+                     SummaryBin *bins,
+                     ShouldExit &&shouldExit)
+ {
+  return analyseSegments(pool, splitter, start, length, binShift,
+                         [&](ChunkedAnalyser &analyser, BandSplitter &segmentSplitter,
+                             juce::int64 segmentStart, juce::int64 segmentLength, auto &&segmentShouldExit)
+  {
+   return analyser.analyse(monoSamples, numSamples, segmentSplitter, segmentStart, segmentLength,
+                           segmentSplitter.getSettlingSamples(),
+                           binShift, binOrigin, bins, segmentShouldExit);
+  }, shouldExit);
+ }
+};
@@ -0,0 +1,184 @@
+/*
+ ==============================================================================
+
+ ColourPalette.h
+ Created: 22 Oct 2026 10:08:31am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include "ScopeReduction.h"
+
+//==============================================================================
+/*
+ Maps each column's band peaks to a colour. The peaks are normalised to the
+ loudest band, four columns at a time with SIMD where it is available, and
+ quantised to 256 levels. Each band's level then picks a colour from that
+ band's lookup table, and the three colours are added and saturated. No
+ per-column division or float conversion is left in the lookup.
+
+ classic() is the original red/green/blue-by-band scheme and matches
+ ScopeDataSource::translateSpectrumToColour to within one level.
+ */
+class ColourPalette
+{
+ // Each entry holds one band's red, green and blue contribution at one level
+ // in bits 32, 16 and 0. A channel never sums past 765, so the three bands
+ // add up with plain 64 bit adds and no carries between channels.
+ std::array<std::array<juce::uint64, 256>, 3> lut;
+
+ static constexpr juce::uint32 SilentFlag = 1u << 24;
+ static constexpr int BlockSize = 64;
+
+ static juce::uint32 saturate(juce::uint64 channel)
+ { return static_cast<juce::uint32>(std::min<juce::uint64>(channel & 0xffff, 255)); }
+
+ template <typename PixelType>
+ static void writeRowInto(juce::Image::BitmapData &data, int y, const juce::PixelARGB *pixels, int numPixels)
+ {
+  juce::uint8 *line = data.getLinePointer(y);
+  for (int x = 0; x < numPixels; ++x)
+  {
+   reinterpret_cast<PixelType*>(line + x*data.pixelStride)->set(pixels[x]);
+  }
+ }
+
+public:
+ ColourPalette(juce::Colour bass, juce::Colour mids, juce::Colour high)
+ {
+  const juce::Colour bands[3] = {bass, mids, high};
+  for (int band = 0; band < 3; ++band)
+  {
+   for (int level = 0; level < 256; ++level)
+   {
+    auto component = [&](juce::uint8 value) { return static_cast<juce::uint64>((value*level + 127)/255); };
+    lut[band][level] = (component(bands[band].getRed()) << 32) |
+    (component(bands[band].getGreen()) << 16) |
+    component(bands[band].getBlue());
+   }
+  }
+ }
+
+ //==============================================================================
+ // Bass red, mids green, highs blue, as the scope has always drawn
+ static ColourPalette classic()
+ { return {juce::Colour(255, 0, 0), juce::Colour(0, 255, 0), juce::Colour(0, 0, 255)}; }
+
+ // Blue lows, amber mids and white highs, after the three band view of
+ // club DJ software
+ static ColourPalette threeBand()
+ { return {juce::Colour(0, 85, 225), juce::Colour(242, 150, 30), juce::Colour(200, 200, 200)}; }
+
+ // Red through orange to yellow as the content gets brighter
+ static ColourPalette heat()
+ { return {juce::Colour(200, 0, 0), juce::Colour(160, 110, 0), juce::Colour(80, 140, 60)}; }
+
+ // One colour which gets brighter as more bands join in
+ static ColourPalette mono(juce::Colour colour)
+ { return {colour.withMultipliedBrightness(0.6f), colour.withMultipliedBrightness(0.6f), colour.withMultipliedBrightness(0.6f)}; }
+
+ //==============================================================================
+ // Packs each bin's bands, scaled so the loudest is 255, into levels as
+ // bass | mids << 8 | high << 16. Silent bins are flagged instead.
+ static void normalise(const SummaryBin *bins, int numColumns, juce::uint32 *levels)
+ {
+  int i = 0;
+
+#if XDLS_REDUCTION_AVX2 || XDLS_REDUCTION_SSE2
+  for (; i + 4 <= numColumns; i += 4)
+  {
+   const SummaryBin *b = bins + i;
+   const __m128 bass = _mm_setr_ps(b[0].bass, b[1].bass, b[2].bass, b[3].bass);
+   const __m128 mids = _mm_setr_ps(b[0].mids, b[1].mids, b[2].mids, b[3].mids);
+   const __m128 high = _mm_setr_ps(b[0].high, b[1].high, b[2].high, b[3].high);
+   const __m128 head = _mm_max_ps(_mm_max_ps(bass, mids), high);
+   const __m128 loud = _mm_cmpgt_ps(head, _mm_setzero_ps());
+   const __m128 scale = _mm_and_ps(loud, _mm_div_ps(_mm_set1_ps(255.f), head));
+   const __m128i packed = _mm_or_si128(_mm_or_si128(_mm_cvttps_epi32(_mm_mul_ps(bass, scale)),
+                                                    _mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(mids, scale)), 8)),
+                                       _mm_or_si128(_mm_slli_epi32(_mm_cvttps_epi32(_mm_mul_ps(high, scale)), 16),
+                                                    _mm_andnot_si128(_mm_castps_si128(loud), _mm_set1_epi32(SilentFlag))));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(levels + i), packed);
+  }
+#elif XDLS_REDUCTION_NEON && (defined(__aarch64__) || defined(_M_ARM64))
+  for (; i + 4 <= numColumns; i += 4)
+  {
+   const SummaryBin *b = bins + i;
+   const float bassLanes[4] = {b[0].bass, b[1].bass, b[2].bass, b[3].bass};
+   const float midsLanes[4] = {b[0].mids, b[1].mids, b[2].mids, b[3].mids};
+   const float highLanes[4] = {b[0].high, b[1].high, b[2].high, b[3].high};
+   const float32x4_t bass = vld1q_f32(bassLanes);
+   const float32x4_t mids = vld1q_f32(midsLanes);
+   const float32x4_t high = vld1q_f32(highLanes);
+   const float32x4_t head = vmaxq_f32(vmaxq_f32(bass, mids), high);
+   const uint32x4_t loud = vcgtq_f32(head, vdupq_n_f32(0.f));
+   const float32x4_t scale = vreinterpretq_f32_u32(vandq_u32(loud, vreinterpretq_u32_f32(vdivq_f32(vdupq_n_f32(255.f), head))));
+   const uint32x4_t packed = vorrq_u32(vorrq_u32(vcvtq_u32_f32(vmulq_f32(bass, scale)),
+                                                 vshlq_n_u32(vcvtq_u32_f32(vmulq_f32(mids, scale)), 8)),
+                                       vorrq_u32(vshlq_n_u32(vcvtq_u32_f32(vmulq_f32(high, scale)), 16),
+                                                 vbicq_u32(vdupq_n_u32(SilentFlag), loud)));
+   vst1q_u32(levels + i, packed);
+  }
+#endif
+
+  for (; i < numColumns; ++i)
+  {
+   const SummaryBin &bin = bins[i];
+   const float head = std::max(std::max(bin.bass, bin.mids), bin.high);
+   if (head > 0.f)
+   {
+    const float scale = 255.f / head;
+    levels[i] = static_cast<juce::uint32>(bin.bass*scale) |
+    (static_cast<juce::uint32>(bin.mids*scale) << 8) |
+    (static_cast<juce::uint32>(bin.high*scale) << 16);
+   }
+   else levels[i] = SilentFlag;
+  }
+ }
+
+ // Looks levels from normalise up in the palette
+ void map(const juce::uint32 *levels, int numColumns, const juce::Colour &silence, juce::PixelARGB *pixels) const
+ {
+  const juce::PixelARGB silentPixel(255, silence.getRed(), silence.getGreen(), silence.getBlue());
+  for (int i = 0; i < numColumns; ++i)
+  {
+   const juce::uint32 level = levels[i];
+   if (level & SilentFlag)
+   {
+    pixels[i] = silentPixel;
+    continue;
+   }
+
+   const juce::uint64 sum = lut[0][level & 0xff] + lut[1][(level >> 8) & 0xff] + lut[2][(level >> 16) & 0xff];
+   pixels[i] = juce::PixelARGB(255,
+                               static_cast<juce::uint8>(saturate(sum >> 32)),
+                               static_cast<juce::uint8>(saturate(sum >> 16)),
+                               static_cast<juce::uint8>(saturate(sum)));
+  }
+ }
+
+ // Both passes, a block at a time so the levels stay in cache
+ void translate(const SummaryBin *bins, int numColumns, const juce::Colour &silence, juce::PixelARGB *pixels) const
+ {
+  juce::uint32 levels[BlockSize];
+  for (int done = 0; done < numColumns; done += BlockSize)
+  {
+   const int count = std::min(BlockSize, numColumns - done);
+   normalise(bins + done, count, levels);
+   map(levels, count, silence, pixels + done);
+  }
+ }
+
+ // Copies pixels into row y of an RGB or ARGB image, starting at x = 0
+ static void writeRow(juce::Image::BitmapData &data, int y, const juce::PixelARGB *pixels, int numPixels)
+ {
+  numPixels = std::min(numPixels, data.width);
+  if (data.pixelFormat == juce::Image::RGB) writeRowInto<juce::PixelRGB>(data, y, pixels, numPixels);
+  else if (data.pixelFormat == juce::Image::ARGB) writeRowInto<juce::PixelARGB>(data, y, pixels, numPixels);
+ }
+};
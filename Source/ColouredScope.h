@@ -13,17 +13,27 @@
 #include <JuceHeader.h>
 #include <utility>
 #include "XDDSP/XDDSP.h"
+#include "SummaryPyramid.h"
+#include "ScopeReduction.h"
+#include "BandSplitter.h"
+#include "ChunkedAnalyser.h"
+#include "WaveformOverview.h"
+#include "DecodedAudioCache.h"
+#include "SpanRasteriser.h"
+#include "StageTimers.h"
+#include "ColourPalette.h"
+#include "ScopeRenderThread.h"
 
 //==============================================================================
 /*
  */
 class ScopeDataSource
 {
-protected:
- juce::Colour translateSpectrumToColour(float bass,
-                                        float mids,
-                                        float high,
-                                        const juce::Colour &defaultColour)
+public:
+ static juce::Colour translateSpectrumToColour(float bass,
+                                               float mids,
+                                               float high,
+                                               const juce::Colour &defaultColour)
  {
   float head = std::max(std::max(bass, mids), high);
   if (head > 0.)
@@ -44,7 +54,6 @@ protected:
                       static_cast<uint8_t>(high));
  }
 
-public:
 // typedef std::pair<float, float> MinMaxPair;
  struct ScopePoint
  {
@@ -53,9 +62,38 @@ public:
   juce::Colour colour;
  };
  
+ // The samples [start, end) of one column, as getRange takes them
+ struct ColumnRange
+ {
+  int start;
+  int end;
+ };
+ 
+ // Used for columns with no band content
+ juce::Colour defaultColour {juce::Colours::white.withBrightness(0.5)};
+ 
  virtual ~ScopeDataSource() {};
  virtual ScopePoint getRange(int start, int end) = 0;
  virtual unsigned int getRangeSize() = 0;
+ 
+ // Batched getRange. Reduces every range into the matching bin in one pass
+ // and returns true, leaving the colours to the scope's ColourPalette.
+ // Sources which don't implement it return false, and the scope falls back
+ // to calling getRange once per column.
+ virtual bool getColumns(const ColumnRange *ranges, int numColumns, SummaryBin *bins)
+ {
+  juce::ignoreUnused(ranges, numColumns, bins);
+  return false;
+ }
+ 
+ // Streaming sources return the absolute position of the next sample to
+ // arrive, so a scope can tell how far the data has scrolled since it last
+ // looked. Sources which don't scroll return -1.
+ virtual int64_t getWritePosition() { return -1; }
+ 
+ // Tells the source how many columns the scope draws, so that sources which
+ // summarise ahead of time can size their summaries to suit
+ virtual void setColumnCount(int) {}
 };
 
 
@@ -67,19 +105,28 @@ public:
 
 
 
-template <typename BufferType>
+template <typename BufferType, typename SummaryType = SummaryPyramid>
 class CircularBufferSource : public ScopeDataSource
 {
  BufferType &buffer;
- BufferType &bassBuffer;
- BufferType &midsBuffer;
- BufferType &highBuffer;
+ 
+ // The streams of buffer holding the waveform and the three bands
+ int streams[4];
+ const SummaryType *summary {nullptr};
  
  unsigned int windowSize;
  
+ // With a summary, ranges can reach back past the full rate buffer into
+ // the summary's long history
+ int getHistoryLength() const
+ {
+  if (!summary) return static_cast<int>(buffer.getSize());
+  return static_cast<int>(std::min<int64_t>(summary->getHistoryLength(), std::numeric_limits<int>::max()));
+ }
+ 
  void constrain(int &index)
  {
-  index = XDDSP::boundary<int>(index, 0, buffer.getSize() - 1);
+  index = XDDSP::boundary<int>(index, 0, getHistoryLength() - 1);
  }
  
  void prepareIndexes(int &start, int &end)
@@ -89,52 +136,71 @@ class CircularBufferSource : public ScopeDataSource
   if (end < start) std::swap(start, end);
  }
  
-public:
- juce::Colour defaultColour {juce::Colours::white.withBrightness(0.5)};
-
- CircularBufferSource(BufferType &fullAudio,
-                      BufferType &bass,
-                      BufferType &mids,
-                      BufferType &highs) :
- buffer(fullAudio),
- bassBuffer(bass),
- midsBuffer(mids),
- highBuffer(highs),
- windowSize(fullAudio.getSize())
- {}
- 
- virtual ScopePoint getRange(int start, int end) override
+ SummaryBin reduceRange(int start, int end)
  {
   prepareIndexes(start, end);
-  ScopePoint result = {buffer.tapOut(start),
-   buffer.tapOut(start),
-   juce::Colours::white};
-  float mb = fabs(bassBuffer.tapOut(start));
-  float mm = fabs(midsBuffer.tapOut(start));
-  float mh = fabs(highBuffer.tapOut(start));
-
-  for (int i = start + 1; i < end; ++i)
+  end = std::max(end, start + 1);
+  if (summary)
   {
-   float t = buffer.tapOut(i);
-   result.min = std::min(result.min, t);
-   result.max = std::max(result.max, t);
-   mb = std::max(mb, fabs(bassBuffer.tapOut(i)));
-   mm = std::max(mm, fabs(midsBuffer.tapOut(i)));
-   mh = std::max(mh, fabs(highBuffer.tapOut(i)));
+   const int64_t total = summary->getTotalSamples();
+   return summary->query(total - end, total - start, [&](int64_t position)
+   {
+    const int i = static_cast<int>(total - 1 - position);
+    return SummaryBin::fromSample(buffer.tapOut(i, streams[0]),
+                                  buffer.tapOut(i, streams[1]),
+                                  buffer.tapOut(i, streams[2]),
+                                  buffer.tapOut(i, streams[3]));
+   });
   }
   
-  result.colour = translateSpectrumToColour(mb, mm, mh, defaultColour);
-  
-  return result;
+  SummaryBin bin = SummaryBin::fromSample(buffer.tapOut(start, streams[0]),
+                                          buffer.tapOut(start, streams[1]),
+                                          buffer.tapOut(start, streams[2]),
+                                          buffer.tapOut(start, streams[3]));
+  buffer.reduce(start, end, streams, bin);
+  return bin;
+ }
+ 
+public:
+ CircularBufferSource(BufferType &history,
+                      int waveStream,
+                      int bassStream,
+                      int midsStream,
+                      int highStream) :
+ buffer(history),
+ streams {waveStream, bassStream, midsStream, highStream},
+ windowSize(history.getSize())
+ {}
+ 
+ // The summary must be fed the same samples as the buffer, and be sized for
+ // the buffer's length. With a summary present, getRange costs O(log n)
+ // instead of O(n), and windows can be as long as the summary's history.
+ // Columns older than the buffer come from the summary's coarser levels.
+ void setSummary(const SummaryType *newSummary)
+ { summary = newSummary; }
+ 
+ virtual ScopePoint getRange(int start, int end) override
+ {
+  const SummaryBin bin = reduceRange(start, end);
+  return {bin.min, bin.max, translateSpectrumToColour(bin.bass, bin.mids, bin.high, defaultColour)};
+ }
+ 
+ virtual bool getColumns(const ColumnRange *ranges, int numColumns, SummaryBin *bins) override
+ {
+  for (int i = 0; i < numColumns; ++i) bins[i] = reduceRange(ranges[i].start, ranges[i].end);
+  return true;
  }
  
  void setWindowSize(unsigned int newSize)
  {
-  windowSize = std::min(newSize, buffer.getSize());
+  windowSize = newSize;
  }
  
  virtual unsigned int getRangeSize() override
- { return windowSize; }
+ { return std::min(windowSize, static_cast<unsigned int>(getHistoryLength())); }
+ 
+ virtual int64_t getWritePosition() override
+ { return summary ? summary->getTotalSamples() : -1; }
 };
 
 
@@ -148,118 +214,406 @@ public:
 
 class AudioFileScopeSource : public ScopeDataSource
 {
- static constexpr unsigned long ProcessingLeadIn = 100;
- static constexpr int NumberBufferChannels = 5;
+ // Everything the worker needs to summarise one window
+ struct Request
+ {
+  juce::File audioFile;
+  long offset {0};
+  int windowSize {0};
+  int columnCount {1024};
+  float lowCrossover {LowXOver};
+  float highCrossover {HighXOver};
+  std::shared_ptr<WaveformOverview> overview;
+  std::shared_ptr<DecodedAudioCache> decoded;
+ };
  
- juce::AudioFormatManager audioFormatManager;
- std::unique_ptr<juce::AudioFormatReader> reader;
- juce::AudioBuffer<float> buffer;
- juce::AudioBuffer<float> leadIn;
+ // A finished window. The window is summarised into bins of 2^binShift
+ // samples, aligned to the file, with bins[0] holding bin number firstBin.
+ // The bins are kept to about half a column each, so memory follows the
+ // scope's width rather than the window length.
+ struct View
+ {
+  long offset {0};
+  int windowSize {0};
+  juce::int64 firstBin {0};
+  int binShift {0};
+  std::vector<SummaryBin> bins;
+ };
  
- XDDSP::Parameters dspParam;
- XDDSP::BiquadFilterCoefficients lowLPCoeff;
- XDDSP::BiquadFilterCoefficients highLPCoeff;
- XDDSP::BiquadFilterKernel lowLP;
- XDDSP::BiquadFilterKernel highLP;
+ //==============================================================================
+ // Summarises windows on its own thread. Requests are coalesced, so while a
+ // drag is in progress only the latest one is worked on, and a request which
+ // is superseded part way through is abandoned. Finished views are published
+ // whole with an atomic store.
+ class Worker : public juce::Thread
+ {
+  juce::CriticalSection requestLock;
+  Request pending;
+  std::atomic<juce::uint64> requested {0};
+  std::atomic<juce::uint64> completed {0};
+  std::shared_ptr<const View> published;
+  
+  // Only touched on the worker thread
+  std::unique_ptr<juce::AudioFormatReader> reader;
+  juce::File readerFile;
+  BandSplitter splitter;
+  ChunkedAnalyser analyser;
+  juce::SharedResourcePointer<ParallelAnalyser::Pool> analysisPool;
+  
+  // What the published view was summarised from, and how far the splitter
+  // has filtered, or -1 if its state can't be carried on from
+  Request previous;
+  juce::int64 splitterPosition {-1};
+  
+  static bool sameSource(const Request &a, const Request &b)
+  {
+   return a.audioFile == b.audioFile && a.lowCrossover == b.lowCrossover && a.highCrossover == b.highCrossover;
+  }
+  
+  bool openReader(const juce::File &file)
+  {
+   if (file != readerFile)
+   {
+    readerFile = file;
+    reader.reset();
+    if (file != juce::File()) reader = ParallelAnalyser::createReaderFor(file);
+   }
+   return reader != nullptr;
+  }
+  
+  // Analyses numBins bins of the view from bin number first on. When the
+  // splitter has just filtered up to the start of them it carries straight
+  // on, so a view scrolled forward needs no lead in.
+  template <typename ShouldExit>
+  bool analyseBins(const Request &request, View &view, juce::int64 first, juce::int64 numBins, ShouldExit &&shouldExit)
+  {
+   if (numBins <= 0) return true;
+   
+   const auto &decoded = request.decoded;
+   const juce::int64 start = first << view.binShift;
+   const juce::int64 length = numBins << view.binShift;
+   const juce::int64 resumeFrom = splitterPosition;
+   splitterPosition = -1;
+   
+   if (length >= 2*ParallelAnalyser::MinimumSegment)
+   {
+    if (decoded) return ParallelAnalyser::analyse(&analysisPool->pool, decoded->getSamples(), decoded->getLengthInSamples(),
+                                                  splitter, start, length, view.binShift, view.firstBin, view.bins.data(), shouldExit);
+    return ParallelAnalyser::analyse(&analysisPool->pool, ParallelAnalyser::readerFactoryFor(request.audioFile),
+                                     splitter, start, length, view.binShift, view.firstBin, view.bins.data(), shouldExit);
+   }
+   
+   bool finished;
+   if (resumeFrom == start)
+   {
+    if (decoded) finished = analyser.resume(decoded->getSamples(), decoded->getLengthInSamples(), splitter, start, length,
+                                            view.binShift, view.firstBin, view.bins.data(), shouldExit);
+    else finished = analyser.resume(*reader, splitter, start, length,
+                                    view.binShift, view.firstBin, view.bins.data(), shouldExit);
+   }
+   else
+   {
+    if (decoded) finished = analyser.analyse(decoded->getSamples(), decoded->getLengthInSamples(), splitter, start, length,
+                                             splitter.getSettlingSamples(), view.binShift, view.firstBin, view.bins.data(), shouldExit);
+    else finished = analyser.analyse(*reader, splitter, start, length, splitter.getSettlingSamples(),
+                                     view.binShift, view.firstBin, view.bins.data(), shouldExit);
+   }
+   
+   if (finished) splitterPosition = start + length;
+   return finished;
+  }
+  
+  // Returns nullptr if the request was superseded or the thread is stopping
+  std::shared_ptr<View> summarise(const Request &request, juce::uint64 generation)
+  {
+   auto view = std::make_shared<View>();
+   view->offset = request.offset;
+   view->windowSize = request.windowSize;
+   if (request.windowSize <= 0) return view;
+   
+   juce::int64 target = request.windowSize / (2*std::max(request.columnCount, 1));
+   while ((juce::int64(2) << view->binShift) <= target) ++view->binShift;
+   const int binShift = view->binShift;
+   
+   view->firstBin = request.offset >> binShift;
+   const juce::int64 lastBin = (request.offset + request.windowSize - 1) >> binShift;
+   view->bins.assign(static_cast<size_t>(lastBin - view->firstBin + 1), {0.f, 0.f, 0.f, 0.f, 0.f});
+   if (!openReader(request.audioFile)) return view;
+   
+   // Coarse enough bins come straight out of the overview
+   const auto &overview = request.overview;
+   const int level = binShift - WaveformOverview::BaseBinShift;
+   if (overview && level >= 0 && level < overview->getNumLevels())
+   {
+    const SummaryBin *source = overview->getBins(level);
+    const juce::int64 numBins = overview->getNumBins(level);
+    for (juce::int64 b = std::max<juce::int64>(view->firstBin, 0); b <= std::min(lastBin, numBins - 1); ++b)
+    {
+     view->bins[static_cast<size_t>(b - view->firstBin)] = source[b];
+    }
+    return view;
+   }
+   
+   const bool unchanged = sameSource(request, previous);
+   if (!unchanged) splitterPosition = -1;
+   splitter.setSampleRate(reader->sampleRate);
+   splitter.setCrossovers(request.lowCrossover, request.highCrossover);
+   
+   // Bins are aligned to the file, so those the last view shares with this
+   // one are copied across and only the newly exposed bins are analysed.
+   // Scrolling costs the distance scrolled rather than the window.
+   juce::int64 sharedFirst = lastBin + 1;
+   juce::int64 sharedLast = lastBin;
+   const auto last = getView();
+   if (unchanged && last && last->binShift == binShift && !last->bins.empty())
+   {
+    const juce::int64 lastViewEnd = last->firstBin + static_cast<juce::int64>(last->bins.size()) - 1;
+    if (last->firstBin <= lastBin && lastViewEnd >= view->firstBin)
+    {
+     sharedFirst = std::max(view->firstBin, last->firstBin);
+     sharedLast = std::min(lastBin, lastViewEnd);
+     std::copy(last->bins.begin() + (sharedFirst - last->firstBin),
+               last->bins.begin() + (sharedLast - last->firstBin + 1),
+               view->bins.begin() + (sharedFirst - view->firstBin));
+    }
+   }
+   
+   auto shouldExit = [this, generation]() { return threadShouldExit() || requested.load() != generation; };
+   if (!analyseBins(request, *view, view->firstBin, sharedFirst - view->firstBin, shouldExit) ||
+       !analyseBins(request, *view, sharedLast + 1, lastBin - sharedLast, shouldExit)) return nullptr;
+   return view;
+  }
+  
+ public:
+  juce::WaitableEvent viewPublished;
+  
+  Worker() :
+  juce::Thread("Audio file scope")
+  {
+   startThread();
+  }
+  
+  ~Worker() override
+  {
+   stopThread(10000);
+  }
+  
+  void post(const Request &request)
+  {
+   {
+    const juce::ScopedLock sl(requestLock);
+    pending = request;
+    ++requested;
+   }
+   notify();
+  }
+  
+  std::shared_ptr<const View> getView() const
+  { return std::atomic_load(&published); }
+  
+  bool isUpToDate() const
+  { return completed.load() == requested.load(); }
+  
+  void run() override
+  {
+   while (!threadShouldExit())
+   {
+    Request request;
+    juce::uint64 generation;
+    {
+     const juce::ScopedLock sl(requestLock);
+     request = pending;
+     generation = requested.load();
+    }
+    
+    if (generation == completed.load())
+    {
+     wait(-1);
+     continue;
+    }
+    
+    if (auto view = summarise(request, generation))
+    {
+     std::atomic_store(&published, std::shared_ptr<const View>(std::move(view)));
+     previous = request;
+     completed = generation;
+     viewPublished.signal();
+    }
+   }
+  }
+ };
  
- float bassSample;
- float midsSample;
- float highSample;
+ //==============================================================================
+ std::unique_ptr<juce::AudioFormatReader> reader;
+ BandSplitter splitter;
+ int columnCount {1024};
  
- void procFilters(float sample)
- {
-  bassSample = lowLP.process(lowLPCoeff, sample);
-  sample -= bassSample;
-  midsSample = highLP.process(highLPCoeff, sample);
-  highSample = sample - midsSample;
- }
+ juce::File audioFile;
+ juce::File overviewDirectory {WaveformOverview::getDefaultCacheDirectory()};
+ juce::File overviewFile;
+ juce::MD5 overviewFingerprint;
+ std::shared_ptr<WaveformOverview> overview;
+ std::shared_ptr<std::atomic<bool>> overviewSucceeded;
+ std::shared_ptr<std::atomic<bool>> overviewBuilt;
+ std::shared_ptr<std::atomic<bool>> overviewCancelled;
+ juce::SharedResourcePointer<WaveformOverview::BuildPool> overviewPool;
+ 
+ // Compressed files can be decoded once into a mapped mono mix, which the
+ // analysers read in place. WAV and AIFF readers are mapped already. Off
+ // until a directory is given, as the cache can grow large.
+ juce::File decodeDirectory;
+ juce::int64 decodeCacheBytes {DecodedAudioCache::DefaultMaximumBytes};
+ juce::File decodedFile;
+ juce::MD5 decodedFingerprint;
+ std::shared_ptr<DecodedAudioCache> decoded;
+ std::shared_ptr<std::atomic<bool>> decodeFinished;
+ std::shared_ptr<std::atomic<bool>> decodeCancelled;
+ juce::SharedResourcePointer<DecodedAudioCache::DecodePool> decodePool;
 
- long offset;
- int windowSize;
+ long offset {0};
+ int windowSize {0};
  float gain {1.f};
  
- void constrain(int &index)
+ // Declared last so it stops before anything it was given goes away
+ Worker worker;
+ 
+ // An overview that is still being built for a file, or crossovers, which
+ // have since been replaced would only hold up the next one on the pool
+ void cancelOverviewBuild()
  {
-  index = XDDSP::boundary<int>(index, 0, windowSize - 1);
+  if (overviewCancelled) overviewCancelled->store(true);
+  overviewCancelled.reset();
+  overviewBuilt.reset();
+  overviewSucceeded.reset();
  }
  
- void prepareIndexes(int &start, int &end)
+ void openOverview()
  {
-  constrain(start);
-  constrain(end);
-  if (end < start) std::swap(start, end);
+  overview.reset();
+  cancelOverviewBuild();
+  if (!reader) return;
+  
+  overviewFingerprint = WaveformOverview::fingerprint(audioFile,
+                                                      splitter.getLowCrossover(),
+                                                      splitter.getHighCrossover());
+  overviewFile = WaveformOverview::getCacheFile(audioFile, overviewFingerprint, overviewDirectory);
+  overview = WaveformOverview::load(overviewFile, overviewFingerprint);
+  
+  // Without an overview the worker reads the file itself, as it does while
+  // one is being built
+  if (!overview && !overviewPool->hasFailed(overviewFile, overviewFingerprint))
+  {
+   overviewSucceeded = std::make_shared<std::atomic<bool>>(false);
+   overviewBuilt = std::make_shared<std::atomic<bool>>(false);
+   overviewCancelled = std::make_shared<std::atomic<bool>>(false);
+   overviewPool->pool.addJob(new WaveformOverview::BuildJob(audioFile,
+                                                            overviewFile,
+                                                            overviewFingerprint,
+                                                            splitter.getLowCrossover(),
+                                                            splitter.getHighCrossover(),
+                                                            overviewSucceeded,
+                                                            overviewBuilt,
+                                                            overviewCancelled), true);
+  }
  }
  
- void readIntoBuffer(long offset, long startInSource, int length)
+ void cancelDecode()
  {
-  float *bp[2];
-  bp[0] = buffer.getWritePointer(0, static_cast<int>(offset));
-  bp[1] = buffer.getWritePointer(1, static_cast<int>(offset));
-  reader->read(bp, 2, startInSource, length);
+  if (decodeCancelled) decodeCancelled->store(true);
+  decodeCancelled.reset();
+  decodeFinished.reset();
  }
-
- void update(long newOffset, int newWindowSize, bool doReset = false)
+ 
+ void openDecodedAudio()
  {
-  if (reader && (newOffset != offset) && (newWindowSize != windowSize))
+  decoded.reset();
+  cancelDecode();
+  if (!reader || !DecodedAudioCache::needsDecoding(*reader) || decodeDirectory == juce::File()) return;
+  
+  decodedFingerprint = DecodedAudioCache::fingerprint(audioFile);
+  decodedFile = DecodedAudioCache::getCacheFile(decodedFingerprint, decodeDirectory);
+  decoded = DecodedAudioCache::load(decodedFile, decodedFingerprint);
+  if (!decoded)
   {
-   // Resize the buffer if required
-   if (newWindowSize != windowSize)
-   {
-    buffer.setSize(NumberBufferChannels, static_cast<int>(newWindowSize), !doReset);
-   }
-   
-   // Do the lead in processing
-   lowLP.reset();
-   highLP.reset();
-   reader->read(&leadIn, 0, ProcessingLeadIn, newOffset - ProcessingLeadIn, true, true);
-   for (int i = 0; i < ProcessingLeadIn; ++i) procFilters(leadIn.getSample(0, i));
-   
-   //    reader->read(&buffer, 0, fillBeginningAmount, newOffset, true, true);
-   readIntoBuffer(0, newOffset, newWindowSize);
-   for (int i = 0; i < newWindowSize; ++i)
-   {
-    procFilters(0.5*(buffer.getSample(0, i) + buffer.getSample(1, i)));
-    buffer.setSample(1, i, bassSample);
-    buffer.setSample(2, i, midsSample);
-    buffer.setSample(3, i, highSample);
-   }
+   decodeFinished = std::make_shared<std::atomic<bool>>(false);
+   decodeCancelled = std::make_shared<std::atomic<bool>>(false);
+   decodePool->pool.addJob(new DecodedAudioCache::BuildJob(audioFile,
+                                                           decodedFile,
+                                                           decodedFingerprint,
+                                                           decodeCacheBytes,
+                                                           decodeFinished,
+                                                           decodeCancelled), true);
   }
-  else
+ }
+ 
+ // Picks up an overview or decoded audio once the background job has
+ // written it. An overview which couldn't be built isn't tried again this
+ // session.
+ void pollOverview()
+ {
+  if (!overview && overviewBuilt && overviewBuilt->load())
   {
-   if (newWindowSize != windowSize)
-   {
-    buffer.setSize(NumberBufferChannels, static_cast<int>(newWindowSize));
-   }
-   buffer.clear();
+   const bool succeeded = overviewSucceeded->load();
+   overviewSucceeded.reset();
+   overviewBuilt.reset();
+   overviewCancelled.reset();
+   if (succeeded) overview = WaveformOverview::load(overviewFile, overviewFingerprint);
+   if (overview) postRequest();
+   else overviewPool->markFailed(overviewFile, overviewFingerprint);
   }
   
+  if (!decoded && decodeFinished && decodeFinished->load())
+  {
+   decodeFinished.reset();
+   decodeCancelled.reset();
+   decoded = DecodedAudioCache::load(decodedFile, decodedFingerprint);
+  }
+ }
+ 
+ void postRequest()
+ {
+  Request request;
+  request.audioFile = reader ? audioFile : juce::File();
+  request.offset = offset;
+  request.windowSize = windowSize;
+  request.columnCount = columnCount;
+  request.lowCrossover = splitter.getLowCrossover();
+  request.highCrossover = splitter.getHighCrossover();
+  request.overview = overview;
+  request.decoded = decoded;
+  worker.post(request);
+ }
+
+ void update(long newOffset, int newWindowSize)
+ {
+  if (newOffset == offset && newWindowSize == windowSize) return;
   offset = newOffset;
   windowSize = newWindowSize;
+  postRequest();
  }
  
 public:
- juce::Colour defaultColour {juce::Colours::white.withBrightness(0.5)};
+ AudioFileScopeSource() {}
  
- AudioFileScopeSource() :
- lowLPCoeff(dspParam),
- highLPCoeff(dspParam)
+ virtual ~AudioFileScopeSource()
  {
-  audioFormatManager.registerBasicFormats();
-  leadIn.setSize(1, ProcessingLeadIn);
+  cancelOverviewBuild();
+  cancelDecode();
  }
  
- virtual ~AudioFileScopeSource() {}
- 
  bool openFile(juce::String filename)
  {
   juce::File fileToAnalyse(filename);
   if (!fileToAnalyse.exists()) return false;
   
-  reader.reset(audioFormatManager.createReaderFor(fileToAnalyse));
+  reader = ParallelAnalyser::createReaderFor(fileToAnalyse);
   if (!reader) return false;
   
-  dspParam.setSampleRate(reader->sampleRate);
-  update(offset, windowSize, true);
+  audioFile = fileToAnalyse;
+  splitter.setSampleRate(reader->sampleRate);
+  openOverview();
+  openDecodedAudio();
+  postRequest();
   
   return true;
  }
@@ -267,6 +621,39 @@ public:
  void closeFile()
  {
   reader.reset();
+  overview.reset();
+  cancelOverviewBuild();
+  decoded.reset();
+  cancelDecode();
+  postRequest();
+ }
+ 
+ // Overviews are cached in this directory, keyed by the fingerprint of the
+ // file. Pass juce::File() to keep them next to the tracks instead.
+ void setOverviewDirectory(const juce::File &directory)
+ {
+  overviewDirectory = directory;
+  openOverview();
+  postRequest();
+ }
+ 
+ // Compressed files are decoded into this directory, which is trimmed to
+ // maximumBytes, least recently used first. They are decoded on the fly
+ // until this is called, or after it is passed juce::File().
+ void setDecodeDirectory(const juce::File &directory,
+                         juce::int64 maximumBytes = DecodedAudioCache::DefaultMaximumBytes)
+ {
+  decodeDirectory = directory;
+  decodeCacheBytes = maximumBytes;
+  openDecodedAudio();
+  postRequest();
+ }
+ 
+ virtual void setColumnCount(int numColumns) override
+ {
+  if (numColumns == columnCount) return;
+  columnCount = numColumns;
+  postRequest();
  }
  
  void setGain(float linearGain)
@@ -282,8 +669,9 @@ public:
  
  void setCrossovers(float low, float high)
  {
-  lowLPCoeff.setLowPassFilter(low, 0.707);
-  highLPCoeff.setLowPassFilter(high, 0.707);
+  splitter.setCrossovers(low, high);
+  openOverview();
+  postRequest();
  }
  
  void setWindowSize(int newWindowSize)
@@ -295,33 +683,79 @@ public:
  void setOffsetAndWindowSize(long newOffset, int newWindowSize)
  { update(newOffset, newWindowSize); }
  
+ // True once the window for the latest settings has been published
+ bool isUpToDate() const
+ { return worker.isUpToDate(); }
+ 
+ // Blocks until the window for the latest settings has been published, or
+ // the timeout runs out. Painting never needs to, it's for tools which want
+ // a finished frame.
+ bool waitForView(int timeoutMilliseconds)
+ {
+  const juce::uint32 deadline = juce::Time::getMillisecondCounter() + static_cast<juce::uint32>(timeoutMilliseconds);
+  while (!worker.isUpToDate())
+  {
+   const int remaining = static_cast<int>(deadline - juce::Time::getMillisecondCounter());
+   if (remaining <= 0) return false;
+   worker.viewPublished.wait(remaining);
+  }
+  return true;
+ }
+ 
+ // Reads the last finished window. While a newer one is being worked on the
+ // old one is stretched over the new window size, so the scope always shows
+ // a whole frame.
  virtual ScopePoint getRange(int start, int end) override
  {
-  prepareIndexes(start, end);
-  float t = gain*0.5*(buffer.getSample(0, start) + buffer.getSample(1, start));
-  ScopePoint result = {t, t, defaultColour};
-
-  float mb = fabs(buffer.getSample(1, start));
-  float mm = fabs(buffer.getSample(2, start));
-  float mh = fabs(buffer.getSample(3, start));
-
-  for (int i = start + 1; i < end; ++i)
+  pollOverview();
+  const auto view = worker.getView();
+  if (windowSize <= 0 || !view || view->bins.empty()) return {0.f, 0.f, defaultColour};
+  
+  const SummaryBin bin = reduceView(*view, start, end);
+  return {bin.min, bin.max, translateSpectrumToColour(bin.bass, bin.mids, bin.high, defaultColour)};
+ }
+ 
+ // Reads every column from the same view
+ virtual bool getColumns(const ColumnRange *ranges, int numColumns, SummaryBin *bins) override
+ {
+  pollOverview();
+  const auto view = worker.getView();
+  if (windowSize <= 0 || !view || view->bins.empty())
   {
-   float t = gain*0.5*(buffer.getSample(0, i) + buffer.getSample(1, i));
-   result.min = std::min(result.min, t);
-   result.max = std::max(result.max, t);
-   mb = std::max(mb, fabs(buffer.getSample(1, i)));
-   mm = std::max(mm, fabs(buffer.getSample(2, i)));
-   mh = std::max(mh, fabs(buffer.getSample(3, i)));
+   std::fill(bins, bins + numColumns, SummaryBin {0.f, 0.f, 0.f, 0.f, 0.f});
+   return true;
   }
   
-  result.colour = translateSpectrumToColour(mb, mm, mh, defaultColour);
-
-  return result;
+  for (int i = 0; i < numColumns; ++i) bins[i] = reduceView(*view, ranges[i].start, ranges[i].end);
+  return true;
  }
  
  virtual unsigned int getRangeSize() override
  { return windowSize; }
+ 
+private:
+ // Merges the view's bins under [start, end) of the current window, with
+ // the gain applied to the extremes
+ SummaryBin reduceView(const View &view, int start, int end) const
+ {
+  start = XDDSP::boundary<int>(start, 0, windowSize - 1);
+  end = XDDSP::boundary<int>(end, 0, windowSize - 1);
+  if (end < start) std::swap(start, end);
+  end = std::max(end, start + 1);
+  
+  const juce::int64 scaledStart = static_cast<juce::int64>(start)*view.windowSize/windowSize;
+  const juce::int64 scaledEnd = std::max(scaledStart + 1, static_cast<juce::int64>(end)*view.windowSize/windowSize);
+  const juce::int64 lastBin = view.firstBin + static_cast<juce::int64>(view.bins.size()) - 1;
+  const juce::int64 first = juce::jlimit(view.firstBin, lastBin, (view.offset + scaledStart) >> view.binShift);
+  const juce::int64 last = juce::jlimit(first, lastBin, (view.offset + scaledEnd - 1) >> view.binShift);
+  SummaryBin bin = view.bins[static_cast<size_t>(first - view.firstBin)];
+  for (juce::int64 b = first + 1; b <= last; ++b) bin.merge(view.bins[static_cast<size_t>(b - view.firstBin)]);
+  
+  bin.min *= gain;
+  bin.max *= gain;
+  if (bin.max < bin.min) std::swap(bin.min, bin.max);
+  return bin;
+ }
 };
 
 
@@ -333,53 +767,289 @@ public:
 
 
 
-class ColouredScope  : public juce::Component
+class ColouredScope  : public juce::Component, private ScopeRenderThread::Client
 {
  juce::Image colourBuffer;
  int calculatedWidth {0};
  juce::Path waveformShape;
- std::vector<float> minimums;
  float lastDetectedScaleFactor {1.};
  
-public:
- bool strokeEnable {false};
- bool fillEnable {true};
- bool centreEnable {false};
+ struct Column
+ {
+  float min;
+  float max;
+  juce::Colour colour;
+ };
  
- juce::Image backgroundImage;
- std::function<void (int, int)> resizeBackgroundImage;
- juce::Colour backgroundColour {juce::Colours::blue.withBrightness(0.1)};
- juce::Colour centreLineColour {juce::Colours::transparentWhite};
-
- bool enableScope {true};
- ScopeDataSource *source {nullptr};
+ // What is on screen, one column per pixel from left to right
+ std::vector<Column> columns;
  
- // Default values are suitable for an audio waveform view
- float verticalMidPoint {0.5};
- float verticalScale {0.5};
- bool reverse {true};
+ // Scratch space for fetching columns from the source in a batch
+ std::vector<ScopeDataSource::ColumnRange> columnRanges;
+ std::vector<SummaryBin> columnBins;
+ std::vector<juce::PixelARGB> columnPixels;
  
- ColouredScope()
+ ColourPalette palette {ColourPalette::classic()};
+ 
+ // Span mode draws into spanImage instead of building waveformShape
+ juce::Image spanImage;
+ std::vector<ScopeSpan> spans;
+ SpanRasteriser rasteriser;
+ 
+ // State for incremental mode. Column c covers the absolute sample range
+ // [c*columnSamples, (c + 1)*columnSamples) and lives in columnRing[c % width]
+ std::vector<Column> columnRing;
+ int64_t newestColumn {-1};
+ unsigned int columnSamples {0};
+ bool columnsReversed {true};
+ 
+ // The newest column colourBuffer and spanImage held when they were last
+ // drawn, so they can be scrolled instead of drawn again, or -1 if they
+ // have to be drawn in full
+ int64_t colourBufferNewest {-1};
+ int64_t spanImageNewest {-1};
+ 
+ // What spanImage was drawn with, as it can only be scrolled while these
+ // stay the same
+ struct SpanSettings
+ {
+  float midPoint;
+  float scale;
+  float outlineWidth;
+  bool fill;
+  bool antialias;
+  
+  bool operator!=(const SpanSettings &other) const
+  {
+   return midPoint != other.midPoint || scale != other.scale || outlineWidth != other.outlineWidth ||
+   fill != other.fill || antialias != other.antialias;
+  }
+ };
+ SpanSettings spanSettings {0.f, 0.f, 0.f, false, false};
+ 
+ // While a render thread is set it owns everything above, and the message
+ // thread only asks for frames and shows them
+ struct RenderRequest
+ {
+  int width;
+  int height;
+  float scaleFactor;
+  juce::Image background;
+ };
+ 
+ ScopeRenderThread *renderThread {nullptr};
+ juce::SpinLock requestLock;
+ RenderRequest request {0, 0, 1.f, {}};
+ bool requestPending {false};
+ DoubleBufferedImage frames;
+ 
+ // Handed over under requestLock, as it may be set while a frame is drawn
+ std::unique_ptr<ColourPalette> nextPalette;
+ 
+ // Fetches the first count entries of columnRanges into columnBins and
+ // columnPixels, in one batch coloured by the palette if the source can
+ void fetchColumns(int count)
  {
+  columnBins.resize(static_cast<size_t>(count));
+  columnPixels.resize(static_cast<size_t>(count));
+  if (source->getColumns(columnRanges.data(), count, columnBins.data()))
+  {
+   palette.translate(columnBins.data(), count, source->defaultColour, columnPixels.data());
+   return;
+  }
+  
+  for (int i = 0; i < count; ++i)
+  {
+   const auto scopePoint = source->getRange(columnRanges[i].start, columnRanges[i].end);
+   columnBins[i].min = scopePoint.min;
+   columnBins[i].max = scopePoint.max;
+   columnPixels[i] = scopePoint.colour.getPixelARGB();
+  }
  }
  
- ~ColouredScope() override
+ // Writes the colours of columns [xs) straight into colourBuffer's row
+ void writeColourBuffer(juce::Range<int> xs)
  {
+  xs = xs.getIntersectionWith({0, colourBuffer.getWidth()});
+  if (xs.isEmpty()) return;
+  columnPixels.resize(static_cast<size_t>(xs.getLength()));
+  for (int x = xs.getStart(); x < xs.getEnd(); ++x) columnPixels[x - xs.getStart()] = columns[x].colour.getPixelARGB();
+  juce::Image::BitmapData row(colourBuffer, xs.getStart(), 0, xs.getLength(), 1, juce::Image::BitmapData::writeOnly);
+  ColourPalette::writeRow(row, 0, columnPixels.data(), xs.getLength());
  }
  
- void forceRedrawBackground()
+ // Everything computed from the columns so far has to be done again
+ void invalidateColumns()
  {
-  int w = getWidth()*lastDetectedScaleFactor;
-  int h = getHeight()*lastDetectedScaleFactor;
-  if (resizeBackgroundImage) resizeBackgroundImage(w, h);
-  repaint();
+  newestColumn = -1;
+  colourBufferNewest = -1;
+  spanImageNewest = -1;
  }
  
- void update()
+ // Scrolls image along by the columns which have arrived since it held
+ // imageNewest, and returns how many of the newest columns have to be
+ // drawn into it again. That is every column unless it could scroll.
+ int scrollColumns(juce::Image &image, int64_t &imageNewest)
+ {
+  const int width = static_cast<int>(columns.size());
+  const int64_t previous = imageNewest;
+  imageNewest = newestColumn;
+  if (newestColumn < 0 || previous < 0 || previous > newestColumn) return width;
+  
+  // The column which was newest was probably only partly filled
+  const int64_t changed = newestColumn - previous + 1;
+  if (changed >= width) return width;
+  
+  const int shift = static_cast<int>(changed) - 1;
+  if (shift > 0)
+  {
+   if (reverse) image.moveImageSection(0, 0, shift, 0, width - shift, image.getHeight());
+   else image.moveImageSection(shift, 0, 0, 0, width - shift, image.getHeight());
+  }
+  return static_cast<int>(changed);
+ }
+ 
+ // Where the newest count columns are on screen
+ juce::Range<int> newestColumnsOnScreen(int count) const
+ {
+  const int width = static_cast<int>(columns.size());
+  return reverse ? juce::Range<int>(width - count, width) : juce::Range<int>(0, count);
+ }
+ 
+ Column &columnAt(int64_t column)
  {
-  const float width = static_cast<float>(getWidth())*lastDetectedScaleFactor;
+  const int64_t size = static_cast<int64_t>(columnRing.size());
+  return columnRing[static_cast<size_t>(((column % size) + size) % size)];
+ }
+ 
+ void updateIncremental(int iWidth, bool widthChanged)
+ {
+  const int64_t writePosition = source->getWritePosition();
+  const unsigned int spc = std::max(1u, static_cast<unsigned int>(std::lround(static_cast<double>(source->getRangeSize()) / iWidth)));
+  const int64_t newest = (writePosition - 1) / spc;
+  
+  // A history which has been cleared starts again from zero
+  if (widthChanged || spc != columnSamples || columnsReversed != reverse ||
+      static_cast<int>(columnRing.size()) != iWidth || newest < newestColumn)
+  {
+   columnRing.assign(iWidth, {0.f, 0.f, juce::Colours::black});
+   columnSamples = spc;
+   columnsReversed = reverse;
+   invalidateColumns();
+  }
+  
+  // The newest column is usually only partly filled, so it is recomputed on
+  // the next update along with every column that has arrived since
+  const int64_t oldest = newest - iWidth + 1;
+  const int64_t firstToCompute = newestColumn < 0 ? oldest : std::max(oldest, newestColumn);
+  
+  const int count = static_cast<int>(newest - firstToCompute + 1);
+  columnRanges.resize(static_cast<size_t>(std::max(count, 0)));
+  for (int i = 0; i < count; ++i)
+  {
+   const int64_t c = firstToCompute + i;
+   const int64_t start = writePosition - (c + 1)*spc;
+   const int64_t end = writePosition - c*spc;
+   columnRanges[i] = {static_cast<int>(std::max<int64_t>(start, 0)), static_cast<int>(end)};
+  }
+  if (count > 0) fetchColumns(count);
+  for (int i = 0; i < count; ++i)
+  {
+   columnAt(firstToCompute + i) = {columnBins[i].min, columnBins[i].max, juce::Colour(columnPixels[i])};
+  }
+  newestColumn = newest;
+  
+  // Copying the columns out of the ring is cheap next to drawing them. Only
+  // the changed ones are coloured, the rest of the row scrolls.
+  for (int x = 0; x < iWidth; ++x) columns[x] = columnAt(reverse ? newest - (iWidth - 1 - x) : newest - x);
+  writeColourBuffer(newestColumnsOnScreen(scrollColumns(colourBuffer, colourBufferNewest)));
+ }
+ 
+ void buildPath(float midPoint, float scale)
+ {
+  XDLS_TIME_STAGE(buildPath);
+  const int width = static_cast<int>(columns.size());
+  for (int x = 0; x < width; ++x)
+  {
+   const float yCoord = midPoint - scale*columns[x].max;
+   if (x == 0) waveformShape.startNewSubPath(0, yCoord);
+   else waveformShape.lineTo(static_cast<float>(x), yCoord);
+  }
+  
+  for (int x = width - 1; x >= 0; --x)
+  {
+   waveformShape.lineTo(static_cast<float>(x), midPoint - scale*columns[x].min);
+  }
+  
+  waveformShape.closeSubPath();
+ }
+ 
+ void rasteriseSpans(int iHeight, float midPoint, float scale, float scaleFactor)
+ {
+  XDLS_TIME_STAGE(rasteriseSpans);
+  const int width = static_cast<int>(columns.size());
+  if (spanImage.isNull() || spanImage.getWidth() != std::max(width, 1) || spanImage.getHeight() != std::max(iHeight, 1))
+  {
+   spanImage = juce::Image(juce::Image::ARGB, std::max(width, 1), std::max(iHeight, 1), true);
+   spanImageNewest = -1;
+  }
+  
+  const SpanSettings settings {midPoint, scale, strokeEnable ? scaleFactor : 0.f, fillEnable, antialiasSpans};
+  if (settings != spanSettings)
+  {
+   spanSettings = settings;
+   spanImageNewest = -1;
+  }
+  
+  spans.resize(columns.size());
+  for (int x = 0; x < width; ++x)
+  {
+   spans[x].top = midPoint - scale*columns[x].max;
+   spans[x].bottom = midPoint - scale*columns[x].min;
+   spans[x].colour = columns[x].colour.getPixelARGB();
+  }
+  
+  rasteriser.fill = settings.fill;
+  rasteriser.antialias = settings.antialias;
+  rasteriser.outlineWidth = settings.outlineWidth;
+  
+  // In incremental mode the image scrolls with the columns, and only the
+  // changed columns are cleared and drawn again. Each column's outline
+  // joins the one to its left, so with the newest columns on the left the
+  // one after them changes too, and with them on the right so does the
+  // first column, which has no column before it once it has scrolled.
+  auto xs = newestColumnsOnScreen(scrollColumns(spanImage, spanImageNewest));
+  const bool outline = settings.outlineWidth > 0.f;
+  if (!reverse && outline) xs.setEnd(std::min(xs.getEnd() + 1, width));
+  
+  auto redraw = [&](juce::Range<int> range)
+  {
+   if (range.isEmpty()) return;
+   spanImage.clear({range.getStart(), 0, range.getLength(), spanImage.getHeight()});
+   juce::Image::BitmapData data(spanImage, juce::Image::BitmapData::readWrite);
+   rasteriser.renderColumns(data, spans.data(), range.getStart(), range.getEnd());
+  };
+  redraw(xs);
+  if (reverse && outline && xs.getStart() > 0) redraw({0, 1});
+ }
+ 
+ // Lays out and fetches the columns of a scope width by height physical
+ // pixels, then builds the path or spans through them
+ void updateColumns(float width, float height, float scaleFactor)
+ {
+  XDLS_TIME_STAGE(scopeUpdate);
+  std::unique_ptr<ColourPalette> newPalette;
+  {
+   const juce::SpinLock::ScopedLockType sl(requestLock);
+   newPalette.swap(nextPalette);
+  }
+  if (newPalette)
+  {
+   palette = *newPalette;
+   invalidateColumns();
+  }
+  
   const int iWidth = static_cast<int>(ceil(width));
-  const float height = static_cast<float>(getHeight())*lastDetectedScaleFactor;
   const float midPoint = verticalMidPoint*static_cast<float>(height);
   const float scale = verticalScale*height;
   waveformShape.clear();
@@ -387,97 +1057,256 @@ public:
   bool widthChanged {false};
   if (iWidth != calculatedWidth)
   {
-   minimums.resize(iWidth);
+   columns.assign(iWidth, {0.f, 0.f, juce::Colours::black});
    calculatedWidth = iWidth;
    widthChanged = true;
   }
   
   if (colourBuffer.isNull() || widthChanged)
   {
-   colourBuffer = juce::Image(juce::Image::PixelFormat::RGB, width, 1, true);
+   colourBuffer = juce::Image(juce::Image::PixelFormat::RGB, std::max(iWidth, 1), 1, true);
+   colourBufferNewest = -1;
   }
   
-  if (source)
+  if (!source) return;
+  source->setColumnCount(iWidth);
+  
+  if (incrementalEnable && source->getWritePosition() >= 0)
+  {
+   updateIncremental(iWidth, widthChanged);
+  }
+  else
   {
+   invalidateColumns();
    unsigned int rangeSize = source->getRangeSize();
 //   unsigned int al = std::max(rangeSize, static_cast<unsigned int>(iWidth));
    unsigned int al = rangeSize;
    float spp = static_cast<float>(al) / static_cast<float>(width);
 
-//   waveformShape.startNewSubPath(0., midPoint);
-   for (int i = 0; i < iWidth - 1; ++i)
+   // Lay out every column first, then fetch them all at once
+   columnRanges.resize(static_cast<size_t>(iWidth));
+   for (int i = 0; i < iWidth; ++i)
    {
     unsigned int sIndex = reverse ? iWidth - i - 1 : i;
     unsigned int fSample = static_cast<unsigned int>(static_cast<float>(sIndex)*spp);
     unsigned int lSample;
     if (spp < 1.) lSample = fSample + 1;
     else lSample = static_cast<unsigned int>(static_cast<float>(sIndex + 1)*spp);
-    auto scopePoint = source->getRange(fSample, lSample);
-
-    minimums[i] = scopePoint.min;
-    const float xCoord = midPoint - scale*scopePoint.max;
-    colourBuffer.setPixelAt(i, 0, scopePoint.colour);
-    if (i == 0)
-    {
-     waveformShape.startNewSubPath(0, xCoord);
-    }
-    else
-    {
-     waveformShape.lineTo(static_cast<float>(i), xCoord);
-    }
-        
-    fSample = lSample;
+    columnRanges[i] = {static_cast<int>(fSample), static_cast<int>(lSample)};
    }
+   fetchColumns(iWidth);
    
-   for (int i = width - 1; i >= 0; --i)
+   for (int i = 0; i < iWidth; ++i) columns[i] = {columnBins[i].min, columnBins[i].max, juce::Colour(columnPixels[i])};
+   juce::Image::BitmapData row(colourBuffer, juce::Image::BitmapData::writeOnly);
+   ColourPalette::writeRow(row, 0, columnPixels.data(), iWidth);
+  }
+  
+  if (renderMode == RenderMode::spans) rasteriseSpans(static_cast<int>(ceil(height)), midPoint, scale, scaleFactor);
+  else buildPath(midPoint, scale);
+ }
+ 
+ // Everything paint shows, for a scope w by h logical pixels
+ void drawScope(juce::Graphics &g, int w, int h, float scaleFactor, const juce::Image &background)
+ {
+  if (background.isValid())
+  {
+   g.drawImage(background, juce::Rectangle<int>(w, h).toFloat(), juce::RectanglePlacement::stretchToFit);
+  }
+  else g.fillAll (backgroundColour);   // clear the background
+  
+  if (enableScope)
+  {
+   juce::Graphics::ScopedSaveState saveState(g);
+   g.addTransform(juce::AffineTransform::scale(1./scaleFactor));
+   if (renderMode == RenderMode::spans)
    {
-    waveformShape.lineTo(static_cast<float>(i), midPoint - scale*minimums[i]);
+    if (spanImage.isValid()) g.drawImageAt(spanImage, 0, 0);
    }
-   
-   waveformShape.closeSubPath();
+   else
+   {
+    g.setTiledImageFill(colourBuffer, 0, 0, 1.0f);
+    if (fillEnable) g.fillPath(waveformShape);
+    if (strokeEnable) g.strokePath(waveformShape, juce::PathStrokeType(scaleFactor));
+   }
+  }
+  
+  if (centreEnable)
+  {
+   g.setColour(centreLineColour);
+   float y = 0.5*h;
+   g.drawLine(0., y, 1.*w, y);
+  }
+ }
+ 
+ void renderFrame(const juce::CriticalSection &sourceLock) override
+ {
+  juce::Image *image = frames.beginFrame();
+  if (!image) return;
+  
+  RenderRequest next;
+  {
+   const juce::SpinLock::ScopedLockType sl(requestLock);
+   if (!requestPending) return;
+   next = request;
+   requestPending = false;
+  }
+  
+  const float width = static_cast<float>(next.width)*next.scaleFactor;
+  const float height = static_cast<float>(next.height)*next.scaleFactor;
+  {
+   const juce::ScopedLock sl(sourceLock);
+   updateColumns(width, height, next.scaleFactor);
+  }
+  
+  const int iWidth = std::max(static_cast<int>(ceil(width)), 1);
+  const int iHeight = std::max(static_cast<int>(ceil(height)), 1);
+  if (image->getWidth() != iWidth || image->getHeight() != iHeight)
+  {
+   *image = juce::Image(juce::Image::ARGB, iWidth, iHeight, true, juce::SoftwareImageType());
+  }
+  else image->clear(image->getBounds());
+  
+  {
+   juce::Graphics g(*image);
+   g.addTransform(juce::AffineTransform::scale(next.scaleFactor));
+   drawScope(g, next.width, next.height, next.scaleFactor, next.background);
+  }
+  frames.finishFrame();
+ }
+ 
+public:
+ bool strokeEnable {false};
+ bool fillEnable {true};
+ bool centreEnable {false};
+ 
+ juce::Image backgroundImage;
+ std::function<void (int, int)> resizeBackgroundImage;
+ juce::Colour backgroundColour {juce::Colours::blue.withBrightness(0.1)};
+ juce::Colour centreLineColour {juce::Colours::transparentWhite};
+
+ bool enableScope {true};
+ ScopeDataSource *source {nullptr};
+ 
+ // Default values are suitable for an audio waveform view
+ float verticalMidPoint {0.5};
+ float verticalScale {0.5};
+ bool reverse {true};
+ 
+ // Only compute the columns which have scrolled in since the last update and
+ // scroll the rest. The colour row, and in spans mode the image, scroll with
+ // them, so only the new columns are drawn; path mode still rebuilds its
+ // path. This needs a source which reports its write position, and snaps
+ // each column to a whole number of samples.
+ bool incrementalEnable {false};
+ 
+ // path fills and strokes a juce::Path through the column extremes. spans
+ // draws each column straight into an image with SpanRasteriser, which is
+ // much cheaper for wide scopes. Both honour fillEnable and strokeEnable.
+ enum class RenderMode
+ {
+  path,
+  spans
+ };
+ RenderMode renderMode {RenderMode::path};
+ bool antialiasSpans {true};
+ 
+ ColouredScope()
+ {
+ }
+ 
+ // Takes effect on the next update, which recolours every column
+ void setPalette(const ColourPalette &newPalette)
+ {
+  auto replacement = std::make_unique<ColourPalette>(newPalette);
+  const juce::SpinLock::ScopedLockType sl(requestLock);
+  nextPalette.swap(replacement);
+ }
+ 
+ ~ColouredScope() override
+ {
+  setRenderThread(nullptr);
+ }
+ 
+ // Draws frames on thread instead of in paint, or in paint again when it is
+ // nullptr. Set everything else up first, as the render thread reads the
+ // settings above while it draws.
+ void setRenderThread(ScopeRenderThread *thread)
+ {
+  if (renderThread) renderThread->removeClient(this);
+  renderThread = thread;
+  invalidateColumns();
+  if (renderThread)
+  {
+   renderThread->addClient(this);
+   update();
+  }
+ }
+ 
+ // The render thread has finished a frame which hasn't been painted yet
+ bool hasNewFrame() const
+ { return renderThread != nullptr && frames.isFrameReady(); }
+ 
+ void forceRedrawBackground()
+ {
+  int w = getWidth()*lastDetectedScaleFactor;
+  int h = getHeight()*lastDetectedScaleFactor;
+  if (resizeBackgroundImage) resizeBackgroundImage(w, h);
+  if (renderThread) update();
+  repaint();
+ }
+ 
+ void update()
+ {
+  if (renderThread)
+  {
+   {
+    const juce::SpinLock::ScopedLockType sl(requestLock);
+    request = {getWidth(), getHeight(), lastDetectedScaleFactor, backgroundImage};
+    requestPending = true;
+   }
+   renderThread->wake();
+   return;
   }
+  
+  updateColumns(static_cast<float>(getWidth())*lastDetectedScaleFactor,
+                static_cast<float>(getHeight())*lastDetectedScaleFactor,
+                lastDetectedScaleFactor);
  }
  
  void paint (juce::Graphics& g) override
  {
+  XDLS_TIME_STAGE(paint);
   if (g.getInternalContext().getPhysicalPixelScaleFactor() != lastDetectedScaleFactor)
   {
    lastDetectedScaleFactor = g.getInternalContext().getPhysicalPixelScaleFactor();
    int w = getWidth()*lastDetectedScaleFactor;
    int h = getHeight()*lastDetectedScaleFactor;
-   update();
    if (resizeBackgroundImage) resizeBackgroundImage(w, h);
+   update();
   }
-
-  if (backgroundImage.isValid())
-  {
-   g.drawImage(backgroundImage, getLocalBounds().toFloat(), juce::RectanglePlacement::stretchToFit);
-  }
-  else g.fillAll (backgroundColour);   // clear the background
   
-  if (enableScope)
+  if (renderThread)
   {
-   juce::Graphics::ScopedSaveState saveState(g);
-   g.addTransform(juce::AffineTransform::scale(1./lastDetectedScaleFactor));
-   g.setTiledImageFill(colourBuffer, 0, 0, 1.0f);
-   if (fillEnable) g.fillPath(waveformShape);
-   if (strokeEnable) g.strokePath(waveformShape, juce::PathStrokeType(lastDetectedScaleFactor));
+   // A request which was waiting for this frame to be taken can go ahead
+   if (frames.takeFrame()) renderThread->wake();
+   const juce::Image &frame = frames.getShownImage();
+   if (frame.isValid())
+   {
+    g.addTransform(juce::AffineTransform::scale(1./lastDetectedScaleFactor));
+    g.drawImageAt(frame, 0, 0);
+   }
+   return;
   }
   
-  if (centreEnable)
-  {
-   g.setColour(centreLineColour);
-   float y = 0.5*getHeight();
-   g.drawLine(0., y, 1.*getWidth(), y);
-  }
+  drawScope(g, getWidth(), getHeight(), lastDetectedScaleFactor, backgroundImage);
  }
  
  void resized() override
  {
   int w = getWidth()*lastDetectedScaleFactor;
   int h = getHeight()*lastDetectedScaleFactor;
-  update();
   if (resizeBackgroundImage) resizeBackgroundImage(w, h);
+  update();
  }
  
 private:
@@ -0,0 +1,285 @@
+/*
+ ==============================================================================
+
+ Crossover.h
+ Created: 19 Oct 2026 9:14:02am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+//==============================================================================
+/*
+ Biquad coefficients shared by Lanes independent channels. The state lives
+ with the caller, so a block loop can keep it in locals. Every step is a
+ loop over lanes with no dependency between them, which the compiler packs
+ into one vector operation.
+
+ Coefficients follow the RBJ cookbook, the filter is transposed direct form
+ II.
+ */
+template <int Lanes>
+class BiquadLanes
+{
+ float b0 {1.f}, b1 {0.f}, b2 {0.f}, a1 {0.f}, a2 {0.f};
+
+ static constexpr double TwoPi = 6.283185307179586;
+
+public:
+ struct State
+ {
+  float z1[Lanes];
+  float z2[Lanes];
+ };
+
+ void setLowPass(double frequency, double q, double sampleRate)
+ {
+  const double w0 = TwoPi*frequency/sampleRate;
+  const double cosW0 = std::cos(w0);
+  const double a0 = 1. + std::sin(w0)/(2.*q);
+  b0 = static_cast<float>((1. - cosW0)/(2.*a0));
+  b1 = static_cast<float>((1. - cosW0)/a0);
+  b2 = b0;
+  a1 = static_cast<float>(-2.*cosW0/a0);
+  a2 = static_cast<float>((2. - a0)/a0);
+ }
+
+ void setHighPass(double frequency, double q, double sampleRate, double gain = 1.)
+ {
+  const double w0 = TwoPi*frequency/sampleRate;
+  const double cosW0 = std::cos(w0);
+  const double a0 = 1. + std::sin(w0)/(2.*q);
+  b0 = static_cast<float>(gain*(1. + cosW0)/(2.*a0));
+  b1 = static_cast<float>(-gain*(1. + cosW0)/a0);
+  b2 = b0;
+  a1 = static_cast<float>(-2.*cosW0/a0);
+  a2 = static_cast<float>((2. - a0)/a0);
+ }
+
+ // Output may alias input
+ void process(const float (&input)[Lanes], float (&output)[Lanes], State &s) const
+ {
+  for (int l = 0; l < Lanes; ++l)
+  {
+   const float x = input[l];
+   const float y = b0*x + s.z1[l];
+   s.z1[l] = b1*x - a1*y + s.z2[l];
+   s.z2[l] = b2*x - a2*y;
+   output[l] = y;
+  }
+ }
+};
+
+
+
+
+
+
+
+
+
+
+//==============================================================================
+/*
+ A Linkwitz-Riley filter of order 2N is a Butterworth of order N applied
+ twice. Each side of a split is built from Sections biquads. The high pass
+ side of an LR2 split is inverted so that the two sides sum to an allpass.
+ */
+template <int Order>
+struct LinkwitzRileyDesign;
+
+template <>
+struct LinkwitzRileyDesign<2>
+{
+ static constexpr int Sections = 1;
+ static constexpr double HighPassGain = -1.;
+ static constexpr double getQ(int) { return 0.5; }
+};
+
+template <>
+struct LinkwitzRileyDesign<4>
+{
+ static constexpr int Sections = 2;
+ static constexpr double HighPassGain = 1.;
+ static constexpr double getQ(int) { return 0.7071067811865476; }
+};
+
+template <>
+struct LinkwitzRileyDesign<8>
+{
+ static constexpr int Sections = 4;
+ static constexpr double HighPassGain = 1.;
+ static constexpr double getQ(int section) { return section % 2 == 0 ? 0.5411961001461971 : 1.3065629648763766; }
+};
+
+
+
+
+
+
+
+
+
+
+// Where the scopes split bass from mids and mids from highs until the user
+// picks other crossovers
+constexpr float LowXOver = 600.f;
+constexpr float HighXOver = 4000.f;
+
+//==============================================================================
+/*
+ Splits Lanes channels into NumBands bands with Linkwitz-Riley crossovers of
+ the given order (2, 4 or 8). The lowest band is the low pass of the input
+ at the first crossover, the high pass carries on to the next crossover,
+ and the last band is whatever passes the last high pass.
+
+ Order, band count and lane count are all fixed at compile time, so the
+ filter loops unroll completely and processing has no branches. Only the
+ crossover frequencies change at run time.
+
+ The bands are only used for their levels, so the lower bands are not
+ phase compensated, and with more than two bands the sum is not an allpass
+ of the input.
+ */
+template <int Order, int NumBands, int Lanes = 1>
+class Crossover
+{
+ static_assert(NumBands >= 2, "A crossover needs at least two bands");
+
+ using Design = LinkwitzRileyDesign<Order>;
+ using Biquad = BiquadLanes<Lanes>;
+ using State = typename Biquad::State;
+
+ static constexpr int NumSplits = NumBands - 1;
+ static constexpr int Sections = Design::Sections;
+
+ struct Filters
+ {
+  State low[NumSplits][Sections];
+  State high[NumSplits][Sections];
+ };
+
+ Biquad lowPass[NumSplits][Sections];
+ Biquad highPass[NumSplits][Sections];
+ Filters filters {};
+
+ double sampleRate {44100.};
+ float frequencies[NumSplits];
+
+ void updateCoefficients()
+ {
+  for (int s = 0; s < NumSplits; ++s)
+  {
+   const double frequency = std::min<double>(frequencies[s], 0.49*sampleRate);
+   for (int k = 0; k < Sections; ++k)
+   {
+    lowPass[s][k].setLowPass(frequency, Design::getQ(k), sampleRate);
+    highPass[s][k].setHighPass(frequency, Design::getQ(k), sampleRate, k == 0 ? Design::HighPassGain : 1.);
+   }
+  }
+ }
+
+ void tick(const float (&input)[Lanes], float (&bands)[NumBands][Lanes], Filters &state) const
+ {
+  float rest[Lanes];
+  std::copy(input, input + Lanes, rest);
+  for (int s = 0; s < NumSplits; ++s)
+  {
+   std::copy(rest, rest + Lanes, bands[s]);
+   for (int k = 0; k < Sections; ++k)
+   {
+    lowPass[s][k].process(bands[s], bands[s], state.low[s][k]);
+    highPass[s][k].process(rest, rest, state.high[s][k]);
+   }
+  }
+  std::copy(rest, rest + Lanes, bands[NumSplits]);
+ }
+
+public:
+ static constexpr int getNumBands() { return NumBands; }
+ static constexpr int getOrder() { return Order; }
+
+ // The crossovers start spread evenly, on a log scale, from LowXOver to
+ // HighXOver
+ Crossover()
+ {
+  for (int s = 0; s < NumSplits; ++s)
+  {
+   const double position = NumSplits == 1 ? 0.5 : static_cast<double>(s)/(NumSplits - 1);
+   frequencies[s] = static_cast<float>(LowXOver*std::pow(static_cast<double>(HighXOver)/LowXOver, position));
+  }
+  updateCoefficients();
+ }
+
+ void setSampleRate(double newSampleRate)
+ {
+  sampleRate = newSampleRate;
+  updateCoefficients();
+ }
+
+ double getSampleRate() const
+ { return sampleRate; }
+
+ // Crossovers must stay in ascending order
+ void setCrossover(int index, float frequency)
+ {
+  frequencies[index] = frequency;
+  updateCoefficients();
+ }
+
+ // Both crossovers of a three band split, with one coefficient update. The
+ // high crossover never goes below the low one.
+ void setCrossovers(float low, float high)
+ {
+  static_assert(NumSplits == 2, "setCrossovers takes the two crossovers of a three band split");
+  frequencies[0] = low;
+  frequencies[1] = std::max(low, high);
+  updateCoefficients();
+ }
+
+ float getCrossover(int index) const
+ { return frequencies[index]; }
+
+ // How many samples it takes for the slowest filter to forget its state to
+ // within the given tolerance
+ int getSettlingSamples(double tolerance = 1e-5) const
+ {
+  double highestQ = 0.;
+  for (int k = 0; k < Sections; ++k) highestQ = std::max(highestQ, Design::getQ(k));
+  const float lowest = *std::min_element(frequencies, frequencies + NumSplits);
+
+  // A pole pair with quality Q decays as exp(-w*t/(2Q))
+  const double decayRate = 6.283185307179586*lowest/(2.*highestQ);
+  return static_cast<int>(std::ceil(std::log(1./tolerance)/decayRate*sampleRate));
+ }
+
+ void reset()
+ { filters = Filters {}; }
+
+ void split(const float (&input)[Lanes], float (&bands)[NumBands][Lanes])
+ { tick(input, bands, filters); }
+
+ // Splits a block of each lane, where band b of lane l is written to
+ // bands[b*Lanes + l]. The filter state is kept in a local for the block.
+ void process(const float *const *input, float *const *bands, int numSamples)
+ {
+  Filters state = filters;
+  for (int i = 0; i < numSamples; ++i)
+  {
+   float x[Lanes];
+   float y[NumBands][Lanes];
+   for (int l = 0; l < Lanes; ++l) x[l] = input[l][i];
+   tick(x, y, state);
+   for (int b = 0; b < NumBands; ++b)
+   {
+    for (int l = 0; l < Lanes; ++l) bands[b*Lanes + l][i] = y[b][l];
+   }
+  }
+  filters = state;
+ }
+};
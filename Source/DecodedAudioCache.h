@@ -0,0 +1,260 @@
+/*
+ ==============================================================================
+
+ DecodedAudioCache.h
+ Created: 20 Oct 2026 10:21:44am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChunkedAnalyser.h"
+
+//==============================================================================
+/*
+ The mono mix of a compressed audio file, decoded once to a file of raw
+ floats and memory mapped when it is used, so seeking and zooming read
+ mapped pages instead of running the decoder again. The mix is the same one
+ the analysers take from a reader, half the sum of the first two channels.
+
+ Uncompressed files don't need this, ParallelAnalyser::createReaderFor
+ already maps them.
+ */
+class DecodedAudioCache
+{
+ struct FileHeader
+ {
+  char magic[8];
+  juce::uint32 version;
+  juce::uint32 reserved;
+  juce::uint8 fingerprint[16];
+  double sampleRate;
+  juce::int64 lengthInSamples;
+ };
+
+ static constexpr char Magic[8] = {'X', 'D', 'L', 'S', 'P', 'C', 'M', '1'};
+
+ // Every cache file mapped in the process, once for each time it is
+ // mapped, so trim() leaves them alone
+ struct MappedFiles
+ {
+  juce::CriticalSection lock;
+  juce::StringArray paths;
+ };
+
+ juce::SharedResourcePointer<MappedFiles> mappedFiles;
+ juce::String mappedPath;
+ std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+ const float *samples {nullptr};
+ double sampleRate {0.};
+ juce::int64 lengthInSamples {0};
+
+public:
+ ~DecodedAudioCache()
+ {
+  if (mappedPath.isEmpty()) return;
+  mappedFile.reset();
+  const juce::ScopedLock sl(mappedFiles->lock);
+  mappedFiles->paths.remove(mappedFiles->paths.indexOf(mappedPath));
+ }
+
+ static constexpr juce::uint32 FormatVersion = 1;
+
+ //==============================================================================
+ static juce::MD5 fingerprint(const juce::File &audioFile)
+ {
+  juce::MemoryOutputStream settings;
+  settings.writeInt(static_cast<int>(FormatVersion));
+  return ParallelAnalyser::fingerprint(audioFile, settings.getMemoryBlock());
+ }
+
+ static juce::File getDefaultCacheDirectory()
+ {
+  return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+  .getChildFile("XDMakesMusic")
+  .getChildFile("XDLightScope")
+  .getChildFile("Decoded");
+ }
+
+ static juce::File getCacheFile(const juce::MD5 &fileFingerprint, const juce::File &cacheDirectory)
+ {
+  return cacheDirectory.getChildFile(fileFingerprint.toHexString() + ".xdpcm");
+ }
+ 
+ // A decoded file takes about 10MB a minute at 44.1kHz
+ static constexpr juce::int64 DefaultMaximumBytes = juce::int64(2) << 30;
+ 
+ // Deletes the least recently used cache files in cacheDirectory until the
+ // rest fit in maximumBytes. The file named by keep, and files which are
+ // mapped anywhere in the process, stay whatever their size.
+ static void trim(const juce::File &cacheDirectory, juce::int64 maximumBytes, const juce::File &keep)
+ {
+  juce::SharedResourcePointer<MappedFiles> mappedFiles;
+  const juce::ScopedLock sl(mappedFiles->lock);
+  
+  auto files = cacheDirectory.findChildFiles(juce::File::findFiles, false, "*.xdpcm");
+  std::sort(files.begin(), files.end(), [](const juce::File &a, const juce::File &b)
+  { return a.getLastAccessTime() > b.getLastAccessTime(); });
+  
+  juce::int64 total = 0;
+  for (const auto &file: files)
+  {
+   const juce::int64 size = file.getSize();
+   if (file == keep || mappedFiles->paths.contains(file.getFullPathName()) || total + size <= maximumBytes) total += size;
+   else file.deleteFile();
+  }
+ }
+
+ // True for files which ParallelAnalyser::createReaderFor can't map
+ static bool needsDecoding(const juce::AudioFormatReader &reader)
+ {
+  return dynamic_cast<const juce::MemoryMappedAudioFormatReader*>(&reader) == nullptr;
+ }
+
+ //==============================================================================
+ // Maps a cache file, returning nullptr unless it is complete and matches
+ // the fingerprint
+ static std::unique_ptr<DecodedAudioCache> load(const juce::File &cacheFile,
+                                                const juce::MD5 &fileFingerprint)
+ {
+  if (!cacheFile.existsAsFile()) return nullptr;
+
+  std::unique_ptr<DecodedAudioCache> result(new DecodedAudioCache());
+
+  // Registered before it is mapped, so trim() can't delete it in between
+  {
+   const juce::ScopedLock sl(result->mappedFiles->lock);
+   result->mappedPath = cacheFile.getFullPathName();
+   result->mappedFiles->paths.add(result->mappedPath);
+  }
+  result->mappedFile = std::make_unique<juce::MemoryMappedFile>(cacheFile, juce::MemoryMappedFile::readOnly);
+  const auto *data = static_cast<const char*>(result->mappedFile->getData());
+  const size_t size = result->mappedFile->getSize();
+  if (data == nullptr || size < sizeof(FileHeader)) return nullptr;
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(FileHeader));
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+      header.version != FormatVersion ||
+      std::memcmp(header.fingerprint, fileFingerprint.getChecksumDataArray(), 16) != 0 ||
+      header.lengthInSamples < 0 ||
+      static_cast<juce::uint64>(header.lengthInSamples)*sizeof(float) > size - sizeof(FileHeader)) return nullptr;
+
+  // Access times aren't kept up to date on every file system, and trim()
+  // goes by them
+  cacheFile.setLastAccessTime(juce::Time::getCurrentTime());
+  result->samples = reinterpret_cast<const float*>(data + sizeof(FileHeader));
+  result->sampleRate = header.sampleRate;
+  result->lengthInSamples = header.lengthInSamples;
+  return result;
+ }
+
+ // Decodes the whole file and writes the cache to destination. Returns
+ // false if it failed or shouldExit() returned true along the way.
+ template <typename ShouldExit>
+ static bool build(juce::AudioFormatReader &reader,
+                   const juce::MD5 &fileFingerprint,
+                   const juce::File &destination,
+                   ShouldExit &&shouldExit)
+ {
+  constexpr int ChunkSize = ChunkedAnalyser::ChunkSize;
+
+  FileHeader header {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = FormatVersion;
+  std::memcpy(header.fingerprint, fileFingerprint.getChecksumDataArray(), 16);
+  header.sampleRate = reader.sampleRate;
+  header.lengthInSamples = reader.lengthInSamples;
+
+  if (!destination.getParentDirectory().createDirectory()) return false;
+  juce::TemporaryFile temporary(destination);
+  {
+   juce::FileOutputStream out(temporary.getFile());
+   if (!out.openedOk()) return false;
+   out.write(&header, sizeof(header));
+
+   juce::AudioBuffer<float> chunk(2, ChunkSize);
+   std::vector<float> mono(ChunkSize);
+   for (juce::int64 position = 0; position < reader.lengthInSamples; position += ChunkSize)
+   {
+    if (shouldExit()) return false;
+
+    const int count = static_cast<int>(std::min<juce::int64>(ChunkSize, reader.lengthInSamples - position));
+    reader.read(&chunk, 0, count, position, true, true);
+    const float *left = chunk.getReadPointer(0);
+    const float *right = chunk.getReadPointer(1);
+    for (int i = 0; i < count; ++i) mono[i] = 0.5f*(left[i] + right[i]);
+    if (!out.write(mono.data(), count*sizeof(float))) return false;
+   }
+
+   out.flush();
+   if (out.getStatus().failed()) return false;
+  }
+
+  return temporary.overwriteTargetFileWithTemporary();
+ }
+
+ //==============================================================================
+ const float *getSamples() const
+ { return samples; }
+
+ juce::int64 getLengthInSamples() const
+ { return lengthInSamples; }
+
+ double getSampleRate() const
+ { return sampleRate; }
+
+ //==============================================================================
+ // Decodes in the background. Shared by every source in the process, and
+ // kept apart from WaveformOverview::BuildPool so a decode doesn't wait for
+ // the overview of the same file to be built.
+ struct DecodePool
+ {
+  juce::ThreadPool pool {1};
+ };
+
+ // Decodes on DecodePool, then trims the cache directory to maximumBytes.
+ // Setting cancelFlag abandons the build.
+ class BuildJob : public juce::ThreadPoolJob
+ {
+  juce::File audioFile;
+  juce::File destination;
+  juce::MD5 fileFingerprint;
+  juce::int64 maximumBytes;
+  std::shared_ptr<std::atomic<bool>> finished;
+  std::shared_ptr<std::atomic<bool>> cancelled;
+
+ public:
+  BuildJob(const juce::File &audio,
+           const juce::File &cacheFile,
+           const juce::MD5 &audioFingerprint,
+           juce::int64 maximumCacheBytes,
+           std::shared_ptr<std::atomic<bool>> finishedFlag,
+           std::shared_ptr<std::atomic<bool>> cancelFlag) :
+  juce::ThreadPoolJob("Decoded audio cache"),
+  audioFile(audio),
+  destination(cacheFile),
+  fileFingerprint(audioFingerprint),
+  maximumBytes(maximumCacheBytes),
+  finished(std::move(finishedFlag)),
+  cancelled(std::move(cancelFlag))
+  {}
+
+  JobStatus runJob() override
+  {
+   if (cancelled->load()) return jobHasFinished;
+   if (auto reader = ParallelAnalyser::createReaderFor(audioFile))
+   {
+    if (build(*reader, fileFingerprint, destination, [this]() { return shouldExit() || cancelled->load(); }))
+    {
+     trim(destination.getParentDirectory(), maximumBytes, destination);
+    }
+   }
+   finished->store(true);
+   return jobHasFinished;
+  }
+ };
+};
@@ -0,0 +1,146 @@
+/*
+ ==============================================================================
+
+ FramePacer.h
+ Created: 21 Oct 2026 11:14:02am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+ Drives a component's animation from the display's vertical blank instead
+ of a fixed timer. No vertical blanks arrive while the component is hidden
+ or minimised, so nothing is drawn then either.
+
+ Each frame calls onFrame, which updates whatever the component draws and
+ returns false if nothing new had arrived. Frames like that aren't
+ repainted. The time spent updating and painting a frame is measured, and
+ when it takes more than budget of the time between frames the pacer draws
+ on every second, third... vertical blank instead, speeding back up once
+ there is room again.
+
+ The component calls paintStarted() at the start of paint() and
+ paintFinished() in paintOverChildren(), so that the paint time includes
+ the children.
+ */
+class FramePacer
+{
+public:
+ struct Stats
+ {
+  double framesPerSecond;
+  // Seconds spent updating and painting a frame
+  double averageFrameTime;
+  double maximumFrameTime;
+  // Frames are drawn on every vblankDivisor'th vertical blank
+  int vblankDivisor;
+  // Vertical blanks on which nothing new had arrived
+  int skippedFrames;
+ };
+
+ static constexpr int MaximumDivisor = 8;
+
+ // Fraction of the time between frames which may go on drawing them
+ double budget {0.5};
+
+ // Frames are never drawn faster than this, even on fast displays
+ double maximumRate {60.};
+
+ FramePacer(juce::Component &component, std::function<bool()> frameCallback) :
+ onFrame(std::move(frameCallback)),
+ attachment(&component, [this]() { verticalBlank(); })
+ {}
+
+ void paintStarted()
+ {
+  if (framePending) paintStart = now();
+ }
+
+ void paintFinished()
+ {
+  if (!framePending || paintStart < 0.) return;
+  framePending = false;
+  recordFrame(updateTime + now() - paintStart);
+  paintStart = -1.;
+ }
+
+ // Returns the stats since the last call
+ Stats takeStats()
+ {
+  const double time = now();
+  const double elapsed = time - statsStart;
+  Stats stats {elapsed > 0. ? framesDrawn/elapsed : 0., averageFrameTime, maximumFrameTime, divisor, skippedFrames};
+  statsStart = time;
+  framesDrawn = 0;
+  maximumFrameTime = 0.;
+  skippedFrames = 0;
+  return stats;
+ }
+
+private:
+ std::function<bool()> onFrame;
+
+ double lastBlank {-1.};
+ double displayPeriod {1./60.};
+ double lastFrame {-1.};
+ int blanksSinceFrame {0};
+ int divisor {1};
+
+ bool framePending {false};
+ double updateTime {0.};
+ double paintStart {-1.};
+
+ double statsStart {now()};
+ int framesDrawn {0};
+ int skippedFrames {0};
+ double averageFrameTime {0.};
+ double maximumFrameTime {0.};
+
+ juce::VBlankAttachment attachment;
+
+ static double now()
+ { return juce::Time::getMillisecondCounterHiRes()*0.001; }
+
+ void verticalBlank()
+ {
+  const double time = now();
+
+  // Track the display's refresh period, ignoring gaps where the component
+  // was hidden
+  if (lastBlank >= 0. && time - lastBlank < 0.1) displayPeriod += 0.05*((time - lastBlank) - displayPeriod);
+  lastBlank = time;
+
+  if (++blanksSinceFrame < divisor) return;
+  if (lastFrame >= 0. && time - lastFrame < 1./maximumRate - 0.5*displayPeriod) return;
+  blanksSinceFrame = 0;
+
+  // A frame whose paint never arrived can't be measured
+  framePending = false;
+  if (!onFrame())
+  {
+   ++skippedFrames;
+   return;
+  }
+
+  lastFrame = time;
+  updateTime = now() - time;
+  framePending = true;
+  ++framesDrawn;
+ }
+
+ void recordFrame(double frameTime)
+ {
+  averageFrameTime += 0.1*(frameTime - averageFrameTime);
+  maximumFrameTime = std::max(maximumFrameTime, frameTime);
+
+  const double allowed = budget*displayPeriod;
+  if (averageFrameTime > allowed*divisor && divisor < MaximumDivisor) ++divisor;
+  else if (divisor > 1 && averageFrameTime < 0.75*allowed*(divisor - 1)) --divisor;
+ }
+};
@@ -0,0 +1,262 @@
+/*
+ ==============================================================================
+
+ FrameRingBuffer.h
+ Created: 18 Oct 2026 2:40:18pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include "ScopeReduction.h"
+
+//==============================================================================
+/*
+ Circular history of frames, where a frame holds one sample of each of
+ NumStreams analysis streams, with a single write index for all of them.
+
+ Frames are stored in blocks of BlockFrames. Within a block each stream's
+ samples are contiguous, and the streams of a block follow each other, so
+ writing a frame or reducing a range of frames streams through one region
+ of memory while the reductions can still use vector loads. Reads pull in
+ every stream of a block, so a ring should only hold streams which are
+ read together, such as one channel's waveform and bands.
+
+ tapOut(0, stream) is the most recent sample of stream.
+ */
+template <int NumStreams, int BlockFrames = 16>
+class FrameRingBuffer
+{
+ static_assert((BlockFrames & (BlockFrames - 1)) == 0, "BlockFrames must be a power of two");
+
+ std::vector<float> storage;
+ int length {0};
+ int writeIndex {0};
+
+ static int offsetOf(int frame, int stream)
+ {
+  return ((frame / BlockFrames)*NumStreams + stream)*BlockFrames + (frame & (BlockFrames - 1));
+ }
+
+ // Reduces the frames [first, first + count) in storage order, which must
+ // not wrap
+ void reduceLinear(int first, int count, const int (&streams)[4], SummaryBin &result) const
+ {
+  const float *data = storage.data();
+  ScopeReduction::reduceInterleaved<BlockFrames>(data + streams[0]*BlockFrames,
+                                                 data + streams[1]*BlockFrames,
+                                                 data + streams[2]*BlockFrames,
+                                                 data + streams[3]*BlockFrames,
+                                                 first, count, BlockStride, result);
+ }
+
+public:
+ static constexpr int BlockStride = NumStreams*BlockFrames;
+
+ // The length is rounded up to a whole number of blocks
+ void setMaximumLength(int newLength)
+ {
+  length = std::max((newLength + BlockFrames - 1) & ~(BlockFrames - 1), BlockFrames);
+  storage.assign(static_cast<size_t>(length)*NumStreams, 0.f);
+  writeIndex = 0;
+ }
+
+ unsigned int getSize() const
+ { return static_cast<unsigned int>(length); }
+
+ void tapIn(const float *frame)
+ {
+  float *block = storage.data() + offsetOf(writeIndex, 0);
+  for (int s = 0; s < NumStreams; ++s) block[s*BlockFrames] = frame[s];
+  if (++writeIndex == length) writeIndex = 0;
+ }
+
+ // Appends count frames given as one pointer per stream
+ void write(const float *const *streams, int count)
+ {
+  int done = 0;
+  while (done < count)
+  {
+   const int run = std::min(count - done, BlockFrames - (writeIndex & (BlockFrames - 1)));
+   for (int s = 0; s < NumStreams; ++s)
+   {
+    std::memcpy(storage.data() + offsetOf(writeIndex, s), streams[s] + done, run*sizeof(float));
+   }
+   done += run;
+   writeIndex += run;
+   if (writeIndex == length) writeIndex = 0;
+  }
+ }
+
+ float tapOut(int index, int stream) const
+ {
+  int frame = writeIndex - 1 - index;
+  if (frame < 0) frame += length;
+  return storage[offsetOf(frame, stream)];
+ }
+
+ // Merges the frames tapOut(start) to tapOut(end - 1) into result, taking the
+ // waveform and the three bands from the given streams.
+ // 0 <= start < end <= getSize()
+ void reduce(int start, int end, const int (&streams)[4], SummaryBin &result) const
+ {
+  int first = writeIndex - end;
+  if (first < 0) first += length;
+  const int count = end - start;
+
+  if (first + count <= length) reduceLinear(first, count, streams, result);
+  else
+  {
+   reduceLinear(first, length - first, streams, result);
+   reduceLinear(0, count - (length - first), streams, result);
+  }
+ }
+};
+
+//==============================================================================
+/*
+ FrameRingBuffer with the streams quantised as they are written. Streams
+ before FirstBandStream are waveforms, stored as int16. The rest are bands,
+ stored as uint8 magnitudes, as only their peaks are ever drawn. See
+ Quantise for the formats.
+
+ Blocks are laid out as in FrameRingBuffer, one array for the waveforms and
+ one for the bands. Reductions work on the codes and only decode the
+ result, so they match a FrameRingBuffer to within the quantisation.
+
+ This saves memory rather than time. Only long windows drawn across few
+ columns read faster than from a FrameRingBuffer.
+ */
+template <int NumStreams, int FirstBandStream, int BlockFrames = 16>
+class PackedFrameRingBuffer
+{
+ static_assert((BlockFrames & (BlockFrames - 1)) == 0, "BlockFrames must be a power of two");
+ static_assert(FirstBandStream > 0 && FirstBandStream < NumStreams, "There must be waveform and band streams");
+
+ static constexpr int NumWaves = FirstBandStream;
+ static constexpr int NumBands = NumStreams - FirstBandStream;
+
+ std::vector<int16_t> waves;
+ std::vector<uint8_t> bands;
+ int length {0};
+ int writeIndex {0};
+
+ static int waveOffset(int frame, int stream)
+ {
+  return ((frame / BlockFrames)*NumWaves + stream)*BlockFrames + (frame & (BlockFrames - 1));
+ }
+
+ static int bandOffset(int frame, int stream)
+ {
+  return ((frame / BlockFrames)*NumBands + stream - FirstBandStream)*BlockFrames + (frame & (BlockFrames - 1));
+ }
+
+ void writeSample(int frame, int stream, float sample)
+ {
+  if (stream < FirstBandStream) waves[waveOffset(frame, stream)] = Quantise::wave(sample);
+  else bands[bandOffset(frame, stream)] = Quantise::magnitude(sample);
+ }
+
+ void reduceLinear(int first, int count, const int (&streams)[4], PackedBin &result) const
+ {
+  auto span = [&](int frame, int frames)
+  {
+   ScopeReduction::reducePackedSpan(waves.data() + waveOffset(frame, streams[0]),
+                                    bands.data() + bandOffset(frame, streams[1]),
+                                    bands.data() + bandOffset(frame, streams[2]),
+                                    bands.data() + bandOffset(frame, streams[3]),
+                                    frames, result);
+  };
+
+  const int end = first + count;
+  const int headEnd = std::min(end, (first + BlockFrames - 1) & ~(BlockFrames - 1));
+  if (headEnd > first) span(first, headEnd - first);
+
+  const int numBlocks = (end - headEnd) / BlockFrames;
+  if (numBlocks > 0)
+  {
+   ScopeReduction::reducePackedBlocks(waves.data() + waveOffset(headEnd, streams[0]),
+                                      bands.data() + bandOffset(headEnd, streams[1]),
+                                      bands.data() + bandOffset(headEnd, streams[2]),
+                                      bands.data() + bandOffset(headEnd, streams[3]),
+                                      BlockFrames, numBlocks, NumWaves*BlockFrames, NumBands*BlockFrames, result);
+  }
+
+  const int tail = headEnd + numBlocks*BlockFrames;
+  if (end > tail) span(tail, end - tail);
+ }
+
+public:
+ // The length is rounded up to a whole number of blocks
+ void setMaximumLength(int newLength)
+ {
+  length = std::max((newLength + BlockFrames - 1) & ~(BlockFrames - 1), BlockFrames);
+  waves.assign(static_cast<size_t>(length)*NumWaves, 0);
+  bands.assign(static_cast<size_t>(length)*NumBands, 0);
+  writeIndex = 0;
+ }
+
+ unsigned int getSize() const
+ { return static_cast<unsigned int>(length); }
+
+ void tapIn(const float *frame)
+ {
+  for (int s = 0; s < NumStreams; ++s) writeSample(writeIndex, s, frame[s]);
+  if (++writeIndex == length) writeIndex = 0;
+ }
+
+ // Appends count frames given as one pointer per stream
+ void write(const float *const *streams, int count)
+ {
+  int done = 0;
+  while (done < count)
+  {
+   const int run = std::min(count - done, BlockFrames - (writeIndex & (BlockFrames - 1)));
+   for (int s = 0; s < NumWaves; ++s)
+   {
+    int16_t *dest = waves.data() + waveOffset(writeIndex, s);
+    for (int i = 0; i < run; ++i) dest[i] = Quantise::wave(streams[s][done + i]);
+   }
+   for (int s = FirstBandStream; s < NumStreams; ++s)
+   {
+    uint8_t *dest = bands.data() + bandOffset(writeIndex, s);
+    for (int i = 0; i < run; ++i) dest[i] = Quantise::magnitude(streams[s][done + i]);
+   }
+   done += run;
+   writeIndex += run;
+   if (writeIndex == length) writeIndex = 0;
+  }
+ }
+
+ // Bands come back as magnitudes
+ float tapOut(int index, int stream) const
+ {
+  int frame = writeIndex - 1 - index;
+  if (frame < 0) frame += length;
+  if (stream < FirstBandStream) return Quantise::wave(waves[waveOffset(frame, stream)]);
+  return Quantise::magnitude(bands[bandOffset(frame, stream)]);
+ }
+
+ // As FrameRingBuffer::reduce. streams[0] must be a waveform stream and the
+ // other three band streams.
+ void reduce(int start, int end, const int (&streams)[4], SummaryBin &result) const
+ {
+  int first = writeIndex - end;
+  if (first < 0) first += length;
+  const int count = end - start;
+
+  PackedBin packed = PackedBin::identity();
+  if (first + count <= length) reduceLinear(first, count, streams, packed);
+  else
+  {
+   reduceLinear(first, length - first, streams, packed);
+   reduceLinear(0, count - (length - first), streams, packed);
+  }
+  result.merge(packed.toSummary());
+ }
+};
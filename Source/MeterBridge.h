@@ -0,0 +1,141 @@
+/*
+ ==============================================================================
+
+ MeterBridge.h
+ Created: 19 Oct 2026 4:48:13pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalysisRegistry.h"
+#include "ColouredScope.h"
+#include "FramePacer.h"
+
+//==============================================================================
+/*
+ Shows every registered scope instance in the process, one row each with
+ its left and right channels stacked. All the rows are updated on the same
+ frame and repainted together, and frames are skipped when none of the
+ instances has anything new.
+ */
+class MeterBridge : public juce::Component, private AnalysisRegistry::Listener
+{
+ struct Row
+ {
+  juce::Label name;
+  std::unique_ptr<ScopeDataSource> sources[2];
+  ColouredScope scopes[2];
+ };
+
+ juce::SharedResourcePointer<AnalysisRegistry> registry;
+ std::vector<std::unique_ptr<Row>> rows;
+ int64_t drawnPositions {-1};
+ FramePacer pacer {*this, [this]() { return drawFrame(); }};
+
+ void rebuild()
+ {
+  rows.clear();
+  int number = 1;
+  for (auto *instance: registry->getInstances())
+  {
+   auto row = std::make_unique<Row>();
+   const auto name = instance->getInstanceName();
+   row->name.setText(name.isNotEmpty() ? name : "Scope " + juce::String(number), juce::dontSendNotification);
+   row->name.setFont(juce::Font(12.f));
+   row->name.setColour(juce::Label::textColourId, juce::Colours::white);
+   addAndMakeVisible(row->name);
+
+   for (int channel = 0; channel < 2; ++channel)
+   {
+    row->sources[channel] = instance->createScopeSource(channel);
+    auto &scope = row->scopes[channel];
+    scope.source = row->sources[channel].get();
+    scope.reverse = true;
+    scope.incrementalEnable = true;
+    scope.renderMode = ColouredScope::RenderMode::spans;
+    addAndMakeVisible(scope);
+   }
+
+   rows.push_back(std::move(row));
+   ++number;
+  }
+  drawnPositions = -1;
+
+  resized();
+  if (onContentChanged) onContentChanged();
+ }
+
+ bool drawFrame()
+ {
+  registry->drain();
+  
+  // The sum of the write positions moves whenever any of them does
+  int64_t positions = 0;
+  for (auto &row: rows) positions += row->sources[0]->getWritePosition();
+  if (positions == drawnPositions) return false;
+  drawnPositions = positions;
+  
+  for (auto &row: rows)
+  {
+   for (auto &scope: row->scopes) scope.update();
+  }
+  repaint();
+  return true;
+ }
+
+ void instancesChanged() override
+ { rebuild(); }
+
+public:
+ static constexpr int RowHeight = 40;
+ static constexpr int NameWidth = 100;
+
+ // Called when instances come or go, so the owner can resize
+ std::function<void()> onContentChanged;
+
+ MeterBridge()
+ {
+  setOpaque(true);
+  registry->addListener(this);
+  rebuild();
+ }
+
+ ~MeterBridge() override
+ {
+  registry->removeListener(this);
+ }
+
+ int getIdealHeight() const
+ { return std::max(1, static_cast<int>(rows.size()))*RowHeight; }
+
+ void paint(juce::Graphics &g) override
+ {
+  pacer.paintStarted();
+  g.fillAll(juce::Colours::black);
+ }
+ 
+ void paintOverChildren(juce::Graphics &) override
+ { pacer.paintFinished(); }
+ 
+ FramePacer::Stats takeFrameStats()
+ { return pacer.takeStats(); }
+
+ void resized() override
+ {
+  auto bounds = getLocalBounds();
+  for (auto &row: rows)
+  {
+   auto rowBounds = bounds.removeFromTop(RowHeight).reduced(0, 1);
+   row->name.setBounds(rowBounds.removeFromLeft(NameWidth));
+   row->scopes[0].setBounds(rowBounds.removeFromTop(rowBounds.getHeight()/2));
+   row->scopes[1].setBounds(rowBounds);
+  }
+ }
+
+private:
+ JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterBridge)
+};
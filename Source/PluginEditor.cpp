@@ -12,14 +12,16 @@
 //==============================================================================
 XDLightScopeAudioProcessorEditor::XDLightScopeAudioProcessorEditor (XDLightScopeAudioProcessor& p)
 : AudioProcessorEditor (&p), audioProcessor (p),
-leftSource(p.leftAudioData,
-           p.bassAudioData,
-           p.midAudioData,
-           p.highAudioData),
-rightSource(p.rightAudioData,
-            p.bassAudioData,
-            p.midAudioData,
-            p.highAudioData)
+leftSource(p.leftHistory,
+           XDLightScopeAudioProcessor::WaveStream,
+           XDLightScopeAudioProcessor::BassStream,
+           XDLightScopeAudioProcessor::MidsStream,
+           XDLightScopeAudioProcessor::HighStream),
+rightSource(p.rightHistory,
+            XDLightScopeAudioProcessor::WaveStream,
+            XDLightScopeAudioProcessor::BassStream,
+            XDLightScopeAudioProcessor::MidsStream,
+            XDLightScopeAudioProcessor::HighStream)
 {
  // Make sure that before the constructor has finished, you've set the
  // editor's size to whatever you need it to be.
@@ -29,9 +31,11 @@ rightSource(p.rightAudioData,
  leftScope.reverse = true;
  leftScope.source = &leftSource;
  leftScope.strokeEnable = true;
+ leftScope.incrementalEnable = true;
  leftScope.centreEnable = true;
  leftScope.centreLineColour = juce::Colours::black;
- leftSource.setWindowSize(66300);
+ leftSource.setWindowSize(XDLightScopeAudioProcessor::DefaultWindowSize);
+ leftSource.setSummary(&p.leftSummary);
 
  addAndMakeVisible(rightScope);
  rightScope.setBounds(0, 80, 400, 80);
@@ -39,47 +43,167 @@ rightSource(p.rightAudioData,
  rightScope.reverse = true;
  rightScope.source = &rightSource;
  rightScope.strokeEnable = true;
+ rightScope.incrementalEnable = true;
  rightScope.centreEnable = true;
  rightScope.centreLineColour = juce::Colours::black;
- rightSource.setWindowSize(66300);
+ rightSource.setWindowSize(XDLightScopeAudioProcessor::DefaultWindowSize);
+ rightSource.setSummary(&p.rightSummary);
+
+ // Bring the histories up to date before the first frame, and start the
+ // statistics afresh. Other editors may be reading these histories on the
+ // render thread already.
+ {
+  const juce::ScopedLock sl(registry->getHistoryLock());
+  audioProcessor.drainAnalysisFifo();
+ }
+ audioProcessor.takeRealtimeStats();
+
+#if XDLS_THREADED_RENDERING
+ // The scopes draw their own images, so caching them again is wasted work
+ leftScope.setBufferedToImage(false);
+ rightScope.setBufferedToImage(false);
+ leftScope.setRenderThread(&renderThread.getObject());
+ rightScope.setRenderThread(&renderThread.getObject());
+#endif
+
+#if JUCE_DEBUG
+ addAndMakeVisible(statsDisplay);
+ statsDisplay.setBounds(0, 0, 400, 16);
+ statsDisplay.setFont(juce::Font(11.f));
+ statsDisplay.setColour(juce::Label::textColourId, juce::Colours::yellow);
+ statsDisplay.setInterceptsMouseClicks(false, false);
+#endif
+
+ addAndMakeVisible(bridgeButton);
+ bridgeButton.setClickingTogglesState(true);
+ bridgeButton.onClick = [this]() { showBridge(bridgeButton.getToggleState()); };
+
+#if XDLS_INSTRUMENTATION
+ addAndMakeVisible(timingsButton);
+ timingsButton.setClickingTogglesState(true);
+ timingsButton.onClick = [this]() { showTimings(timingsButton.getToggleState()); };
+#endif
 
  setSize (400, 160);
- startTimerHz(30);
 }
 
 XDLightScopeAudioProcessorEditor::~XDLightScopeAudioProcessorEditor()
 {
+#if XDLS_THREADED_RENDERING
+ // Waits for any frame still being drawn from the sources
+ leftScope.setRenderThread(nullptr);
+ rightScope.setRenderThread(nullptr);
+#endif
+}
+
+void XDLightScopeAudioProcessorEditor::showBridge(bool shouldShow)
+{
+ leftScope.setVisible(!shouldShow);
+ rightScope.setVisible(!shouldShow);
+ if (shouldShow)
+ {
+  bridge = std::make_unique<MeterBridge>();
+  bridge->onContentChanged = [this]() { setSize(400, std::max(160, bridge->getIdealHeight())); };
+  addAndMakeVisible(*bridge);
+  bridge->onContentChanged();
+ }
+ else
+ {
+  bridge.reset();
+  setSize(400, 160);
+ }
+#if XDLS_INSTRUMENTATION
+ // The timings stay above a new bridge
+ if (timings) timings->toFront(false);
+ timingsButton.toFront(false);
+#endif
+ bridgeButton.toFront(false);
+ drawnPosition = -1;
+ resized();
 }
 
-void XDLightScopeAudioProcessorEditor::timerCallback()
+void XDLightScopeAudioProcessorEditor::showTimings(bool shouldShow)
 {
- double waitTime;
+#if XDLS_INSTRUMENTATION
+ if (shouldShow)
  {
-  std::lock_guard<std::mutex> lock(audioProcessor.buffMutex);
+  if (!timings) timings = std::make_unique<StageTimerOverlay>();
+  addAndMakeVisible(*timings);
+  timings->toFront(false);
+  bridgeButton.toFront(false);
+  timingsButton.toFront(false);
+ }
+ else timings.reset();
+ resized();
+#else
+ juce::ignoreUnused(shouldShow);
+#endif
+}
+
+bool XDLightScopeAudioProcessorEditor::drawFrame()
+{
+ // A meter bridge paces itself
+ registry->drain();
+ if (bridge) return false;
+ 
+ // With a render thread, update() only asks for a frame, and it is painted
+ // on a later vertical blank once it has been drawn
+ const int64_t position = leftSource.getWritePosition();
+ const bool newSamples = position != drawnPosition;
+ if (newSamples)
+ {
+  drawnPosition = position;
   leftScope.update();
   rightScope.update();
-  waitTime = audioProcessor.maximumWaitOnMutex.count();
-  audioProcessor.maximumWaitOnMutex = audioProcessor.maximumWaitOnMutex.zero();
  }
+#if XDLS_THREADED_RENDERING
+ if (!leftScope.hasNewFrame() && !rightScope.hasNewFrame()) return false;
+#else
+ if (!newSamples) return false;
+#endif
+ 
+ auto stats = audioProcessor.takeRealtimeStats();
+#if JUCE_DEBUG
+ if (juce::Time::getMillisecondCounter() - frameStatsTaken >= 500)
+ {
+  frameStats = pacer.takeStats();
+  frameStatsTaken = juce::Time::getMillisecondCounter();
+ }
+ statsDisplay.setText(juce::String(stats.maximumBlockTime*1000., 3) + "ms block, fifo " +
+                      juce::String(stats.fifoHighWater) + "/" + juce::String(stats.fifoCapacity) +
+                      (stats.droppedSamples > 0 ? ", dropped " + juce::String(stats.droppedSamples) : juce::String()) +
+                      ", " + juce::String(frameStats.framesPerSecond, 1) + "fps " +
+                      juce::String(frameStats.averageFrameTime*1000., 2) + "ms frame",
+                      juce::NotificationType::dontSendNotification);
+#else
+ juce::ignoreUnused(stats);
+#endif
 
-/* waitDisplay.setText(juce::String(waitTime, 5) + "s" +
-                     (audioProcessor.longWait ? " longwait!" : ""),
-                     juce::NotificationType::dontSendNotification);
- */
  leftScope.repaint();
  rightScope.repaint();
+ return true;
 }
 
 
 //==============================================================================
 void XDLightScopeAudioProcessorEditor::paint (juce::Graphics& g)
 {
+ pacer.paintStarted();
  // (Our component is opaque, so we must completely fill the background with a solid colour)
 // g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
 }
 
+void XDLightScopeAudioProcessorEditor::paintOverChildren (juce::Graphics&)
+{
+ pacer.paintFinished();
+}
+
 void XDLightScopeAudioProcessorEditor::resized()
 {
- // This is generally where you'll want to lay out the positions of any
- // subcomponents in your editor..
+ bridgeButton.setBounds(getWidth() - 56, getHeight() - 20, 52, 16);
+ if (bridge) bridge->setBounds(getLocalBounds());
+#if XDLS_INSTRUMENTATION
+ timingsButton.setBounds(getWidth() - 116, getHeight() - 20, 56, 16);
+ if (timings) timings->setBounds(getLocalBounds());
+#endif
 }
@@ -11,11 +11,15 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 #include "ColouredScope.h"
+#include "MeterBridge.h"
+#include "FramePacer.h"
+#include "StageTimers.h"
+#include "ScopeRenderThread.h"
 
 //==============================================================================
 /**
  */
-class XDLightScopeAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Timer
+class XDLightScopeAudioProcessorEditor  : public juce::AudioProcessorEditor
 {
 public:
  XDLightScopeAudioProcessorEditor (XDLightScopeAudioProcessor&);
@@ -23,18 +27,46 @@ public:
  
  //==============================================================================
  void paint (juce::Graphics&) override;
+ void paintOverChildren (juce::Graphics&) override;
  void resized() override;
- 
- virtual void timerCallback() override;
 
 private:
+ bool drawFrame();
+ void showBridge(bool shouldShow);
+ void showTimings(bool shouldShow);
+ 
+
  // This reference is provided as a quick way for your editor to
  // access the processor object that created it.
  XDLightScopeAudioProcessor& audioProcessor;
  
+#if XDLS_THREADED_RENDERING
+ // Declared before the scopes, which stop using it as they are deleted
+ juce::SharedResourcePointer<ScopeRenderThread> renderThread;
+#endif
+ // Declared before the scopes, so a frame being drawn never outlives them
+ CircularBufferSource<decltype(audioProcessor.leftHistory), decltype(audioProcessor.leftSummary)> leftSource;
+ CircularBufferSource<decltype(audioProcessor.leftHistory), decltype(audioProcessor.leftSummary)> rightSource;
  ColouredScope leftScope;
  ColouredScope rightScope;
- CircularBufferSource<decltype(audioProcessor.leftAudioData)> leftSource;
- CircularBufferSource<decltype(audioProcessor.rightAudioData)> rightSource;
+ 
+ // Every instance in the process, in place of this instance's scopes
+ juce::SharedResourcePointer<AnalysisRegistry> registry;
+ juce::TextButton bridgeButton {"Bridge"};
+ std::unique_ptr<MeterBridge> bridge;
+ 
+ // Frames are only drawn when new samples have arrived since this
+ int64_t drawnPosition {-1};
+ FramePacer pacer {*this, [this]() { return drawFrame(); }};
+ 
+#if JUCE_DEBUG
+ juce::Label statsDisplay;
+ FramePacer::Stats frameStats {};
+ juce::uint32 frameStatsTaken {0};
+#endif
+#if XDLS_INSTRUMENTATION
+ juce::TextButton timingsButton {"Timings"};
+ std::unique_ptr<StageTimerOverlay> timings;
+#endif
  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (XDLightScopeAudioProcessorEditor)
 };
@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "StageTimers.h"
 
 //==============================================================================
 XDLightScopeAudioProcessor::XDLightScopeAudioProcessor()
@@ -22,22 +23,23 @@ XDLightScopeAudioProcessor::XDLightScopeAudioProcessor()
                   )
 #endif
 ,
-lowLPCoeff(dspParam),
-highLPCoeff(dspParam)
+bandBuffer(NumAnalysisStreams - LeftBassStream, 512)
 {
- static constexpr int smplLength = 5*44100;
-
- lowLPCoeff.setLowPassFilter(LowXOver, 0.707);
- highLPCoeff.setLowPassFilter(HighXOver, 0.707);
- leftAudioData.setMaximumLength(smplLength);
- rightAudioData.setMaximumLength(smplLength);
- bassAudioData.setMaximumLength(smplLength);
- midAudioData.setMaximumLength(smplLength);
- highAudioData.setMaximumLength(smplLength);
+ addParameter(lowCrossover = new juce::AudioParameterFloat("lowCrossover", "Low Crossover",
+                                                           juce::NormalisableRange<float>(40.f, 2000.f, 0.f, 0.4f),
+                                                           LowXOver));
+ addParameter(highCrossover = new juce::AudioParameterFloat("highCrossover", "High Crossover",
+                                                            juce::NormalisableRange<float>(500.f, 16000.f, 0.f, 0.4f),
+                                                            HighXOver));
+ crossover.setCrossovers(LowXOver, HighXOver);
+ setHistorySampleRate(44100.);
+ 
+ registry->addInstance(this);
 }
 
 XDLightScopeAudioProcessor::~XDLightScopeAudioProcessor()
 {
+ registry->removeInstance(this);
 }
 
 //==============================================================================
@@ -105,9 +107,25 @@ void XDLightScopeAudioProcessor::changeProgramName (int index, const juce::Strin
 //==============================================================================
 void XDLightScopeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
- dspParam.setSampleRate(sampleRate);
- dspParam.setBufferSize(samplesPerBlock);
- procBuffer.resize(samplesPerBlock);
+ crossover.setSampleRate(sampleRate);
+ crossover.reset();
+ bandBuffer.setSize(NumAnalysisStreams - LeftBassStream, std::max(samplesPerBlock, 1));
+
+ // Hosts may call this on any thread, while scopes are reading the
+ // histories, so they are resized by the next drain instead
+ pendingSampleRate.store(sampleRate);
+}
+
+void XDLightScopeAudioProcessor::setHistorySampleRate(double sampleRate)
+{
+ const int fullRateLength = static_cast<int>(std::ceil(FullRateSeconds*sampleRate));
+ const auto longLength = static_cast<int64_t>(std::ceil(LongHistorySeconds*sampleRate));
+ 
+ leftHistory.setMaximumLength(fullRateLength);
+ rightHistory.setMaximumLength(fullRateLength);
+ leftSummary.setMaximumLength(static_cast<int>(leftHistory.getSize()), longLength);
+ rightSummary.setMaximumLength(static_cast<int>(rightHistory.getSize()), longLength);
+ historySampleRate = sampleRate;
 }
 
 void XDLightScopeAudioProcessor::releaseResources()
@@ -151,37 +169,79 @@ void XDLightScopeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
  for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
   buffer.clear (i, 0, buffer.getNumSamples());
  
- float sumScale = 1./static_cast<float>(getTotalNumInputChannels());
-
- for (auto i = 0; i < buffer.getNumSamples(); ++i)
+ const auto startTicks = juce::Time::getHighResolutionTicks();
+ const int numSamples = buffer.getNumSamples();
+ const float *left = buffer.getReadPointer(0);
+ const float *right = buffer.getReadPointer(std::min(1, buffer.getNumChannels() - 1));
+ 
+ // The high crossover never goes below the low one
+ const float low = lowCrossover->get();
+ const float high = std::max(low, highCrossover->get());
+ if (low != crossover.getCrossover(0) || high != crossover.getCrossover(1))
+ {
+  crossover.setCrossovers(low, high);
+ }
+ 
+ float *const *bands = bandBuffer.getArrayOfWritePointers();
+ 
+ // Hosts may send more than they promised in prepareToPlay, so go through
+ // the block in pieces which fit bandBuffer
+ for (int done = 0; done < numSamples; )
  {
-  float sum = 0.;
-  for (int c = 0; c < getTotalNumInputChannels(); ++c)
+  const int count = std::min(numSamples - done, bandBuffer.getNumSamples());
+  const float *input[2] = {left + done, right + done};
+  crossover.process(input, bands, count);
+  
+  const float *streams[NumAnalysisStreams] {input[0], input[1]};
+  for (int stream = LeftBassStream; stream < NumAnalysisStreams; ++stream) streams[stream] = bands[stream - LeftBassStream];
+  
+  // The FIFO hands out at most two segments, each one a straight copy
+  analysisFifo.write(count, [&](float *const *dest, int offset, int segmentLength)
   {
-   sum += buffer.getSample(c, i);
-  }
-  sum *= sumScale;
-  procBuffer[i] = sum;
+   for (int stream = 0; stream < NumAnalysisStreams; ++stream)
+   {
+    juce::FloatVectorOperations::copy(dest[stream], streams[stream] + offset, segmentLength);
+   }
+  });
+  done += count;
  }
  
+ const auto blockTicks = juce::Time::getHighResolutionTicks() - startTicks;
+ XDLS_RECORD_STAGE(processBlock, blockTicks);
+ if (blockTicks > maximumBlockTicks.load(std::memory_order_relaxed))
  {
-  std::lock_guard<std::mutex> lock(buffMutex);
+  maximumBlockTicks.store(blockTicks, std::memory_order_relaxed);
+ }
+}
 
-  for (auto i = 0; i < buffer.getNumSamples(); ++i)
+void XDLightScopeAudioProcessor::drainAnalysisFifo()
+{
+ XDLS_TIME_STAGE(drainAnalysis);
+ const double sampleRate = pendingSampleRate.load();
+ if (sampleRate != historySampleRate) setHistorySampleRate(sampleRate);
+ 
+ analysisFifo.read([&](const float *const *src, int, int count)
+ {
+  const float *left[NumChannelStreams] {src[LeftStream], src[LeftBassStream], src[LeftMidsStream], src[LeftHighStream]};
+  const float *right[NumChannelStreams] {src[RightStream], src[RightBassStream], src[RightMidsStream], src[RightHighStream]};
+  leftHistory.write(left, count);
+  rightHistory.write(right, count);
+  for (auto i = 0; i < count; ++i)
   {
-   leftAudioData.tapIn(buffer.getSample(0, i));
-   rightAudioData.tapIn(buffer.getSample(1, i));
-   
-   float sum = procBuffer[i];
-   float lp = lowLP.process(lowLPCoeff, sum);
-   bassAudioData.tapIn(lp);
-   sum -= lp;
-   lp = highLP.process(highLPCoeff, sum);
-   midAudioData.tapIn(lp);
-   sum -= lp;
-   highAudioData.tapIn(sum);
+   leftSummary.tapIn(left[WaveStream][i], left[BassStream][i], left[MidsStream][i], left[HighStream][i]);
+   rightSummary.tapIn(right[WaveStream][i], right[BassStream][i], right[MidsStream][i], right[HighStream][i]);
   }
- }
+ });
+}
+
+XDLightScopeAudioProcessor::RealtimeStats XDLightScopeAudioProcessor::takeRealtimeStats()
+{
+ RealtimeStats stats;
+ stats.fifoHighWater = analysisFifo.takeHighWater();
+ stats.fifoCapacity = analysisFifo.getCapacity();
+ stats.droppedSamples = analysisFifo.takeDroppedSamples();
+ stats.maximumBlockTime = juce::Time::highResolutionTicksToSeconds(maximumBlockTicks.exchange(0, std::memory_order_relaxed));
+ return stats;
 }
 
 //==============================================================================
@@ -198,15 +258,49 @@ juce::AudioProcessorEditor* XDLightScopeAudioProcessor::createEditor()
 //==============================================================================
 void XDLightScopeAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
- // You should use this method to store your parameters in the memory block.
- // You could do that either as raw data, or use the XML or ValueTree classes
- // as intermediaries to make it easy to save and load complex data.
+ juce::XmlElement state("XDLightScope");
+ state.setAttribute("lowCrossover", lowCrossover->get());
+ state.setAttribute("highCrossover", highCrossover->get());
+ copyXmlToBinary(state, destData);
 }
 
 void XDLightScopeAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
- // You should use this method to restore your parameters from this memory block,
- // whose contents will have been created by the getStateInformation() call.
+ if (auto state = getXmlFromBinary(data, sizeInBytes))
+ {
+  *lowCrossover = static_cast<float>(state->getDoubleAttribute("lowCrossover", LowXOver));
+  *highCrossover = static_cast<float>(state->getDoubleAttribute("highCrossover", HighXOver));
+ }
+}
+
+void XDLightScopeAudioProcessor::updateTrackProperties (const TrackProperties& properties)
+{
+ {
+  const juce::ScopedLock sl(trackNameLock);
+  trackName = properties.name;
+ }
+ registry->instanceRenamed();
+}
+
+//==============================================================================
+void XDLightScopeAudioProcessor::drainAnalysis()
+{
+ drainAnalysisFifo();
+}
+
+juce::String XDLightScopeAudioProcessor::getInstanceName() const
+{
+ const juce::ScopedLock sl(trackNameLock);
+ return trackName;
+}
+
+std::unique_ptr<ScopeDataSource> XDLightScopeAudioProcessor::createScopeSource(int channel)
+{
+ auto source = std::make_unique<CircularBufferSource<decltype(leftHistory), decltype(leftSummary)>>(channel == 0 ? leftHistory : rightHistory,
+                                                                                                    WaveStream, BassStream, MidsStream, HighStream);
+ source->setSummary(channel == 0 ? &leftSummary : &rightSummary);
+ source->setWindowSize(DefaultWindowSize);
+ return source;
 }
 
 //==============================================================================
@@ -9,12 +9,23 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "XDDSP/XDDSP.h"
+#include "AnalysisFifo.h"
+#include "Crossover.h"
+#include "AnalysisRegistry.h"
+#include "SummaryPyramid.h"
+#include "FrameRingBuffer.h"
+
+// Histories are kept as floats unless the project asks for the quantised
+// format, which needs about a third of the memory. It saves memory at the
+// cost of speed: at the default window, reading it is up to twice as slow.
+#ifndef XDLS_COMPACT_HISTORY
+#define XDLS_COMPACT_HISTORY 0
+#endif
 
 //==============================================================================
 /**
  */
-class XDLightScopeAudioProcessor  : public juce::AudioProcessor
+class XDLightScopeAudioProcessor  : public juce::AudioProcessor, public AnalysisRegistry::Instance
 {
 public:
  //==============================================================================
@@ -54,29 +65,110 @@ public:
  void getStateInformation (juce::MemoryBlock& destData) override;
  void setStateInformation (const void* data, int sizeInBytes) override;
  
- XDDSP::DynamicCircularBuffer<float> leftAudioData;
- XDDSP::DynamicCircularBuffer<float> rightAudioData;
- XDDSP::DynamicCircularBuffer<float> bassAudioData;
- XDDSP::DynamicCircularBuffer<float> midAudioData;
- XDDSP::DynamicCircularBuffer<float> highAudioData;
- XDDSP::Parameters dspParam;
- std::mutex buffMutex;
+ void updateTrackProperties (const TrackProperties& properties) override;
  
- bool longWait {false};
+ //==============================================================================
+ void drainAnalysis() override;
+ juce::String getInstanceName() const override;
+ std::unique_ptr<ScopeDataSource> createScopeSource(int channel) override;
+ 
+ // Statistics describing how the audio thread and the editor are keeping up
+ // with each other, collected since the last call to takeRealtimeStats()
+ struct RealtimeStats
+ {
+  int fifoHighWater;
+  int fifoCapacity;
+  unsigned int droppedSamples;
+  double maximumBlockTime;
+ };
+ 
+ // Moves everything the audio thread has produced since the last call into
+ // the histories and summaries below, first resizing them if the sample rate
+ // has changed. Only call this from the message thread, with the
+ // AnalysisRegistry's history lock held. The message thread is also the only
+ // thread allowed to read the histories without holding that lock.
+ void drainAnalysisFifo();
+ 
+ RealtimeStats takeRealtimeStats();
+ 
+ // Each channel gets its own bands. The band streams are in the order the
+ // crossover writes them, band by band with the channels side by side.
+ enum AnalysisStream
+ {
+  LeftStream,
+  RightStream,
+  LeftBassStream,
+  RightBassStream,
+  LeftMidsStream,
+  RightMidsStream,
+  LeftHighStream,
+  RightHighStream,
+  NumAnalysisStreams
+ };
+ 
+ // Each channel's history holds its waveform and bands in this order, so a
+ // scope reads only the streams it draws
+ enum ChannelStream
+ {
+  WaveStream,
+  BassStream,
+  MidsStream,
+  HighStream,
+  NumChannelStreams
+ };
+ 
+ // The histories keep the last FullRateSeconds of each channel, and the
+ // summaries go on to cover LongHistorySeconds at decreasing resolution.
+ // All are resized, and cleared, by the first drain after the sample rate
+ // changes.
+#if XDLS_COMPACT_HISTORY
+ PackedFrameRingBuffer<NumChannelStreams, BassStream> leftHistory;
+ PackedFrameRingBuffer<NumChannelStreams, BassStream> rightHistory;
+ PackedSummaryPyramid leftSummary;
+ PackedSummaryPyramid rightSummary;
+#else
+ FrameRingBuffer<NumChannelStreams> leftHistory;
+ FrameRingBuffer<NumChannelStreams> rightHistory;
+ SummaryPyramid leftSummary;
+ SummaryPyramid rightSummary;
+#endif
  
- std::chrono::duration<double> maximumWaitOnMutex {0};
-
- static constexpr float LowXOver = 600.;
- static constexpr float HighXOver = 4000.;
+ static constexpr double FullRateSeconds = 5.;
+ static constexpr double LongHistorySeconds = 4.*60.*60.;
  
-private:
+ // Samples shown across a scope until the user picks another window
+ static constexpr int DefaultWindowSize = 66300;
  
- std::vector<float> procBuffer;
+ // Crossover frequencies of this instance, automatable and saved with the
+ // session
+ juce::AudioParameterFloat *lowCrossover;
+ juce::AudioParameterFloat *highCrossover;
  
- XDDSP::BiquadFilterCoefficients lowLPCoeff;
- XDDSP::BiquadFilterCoefficients highLPCoeff;
- XDDSP::BiquadFilterKernel lowLP;
- XDDSP::BiquadFilterKernel highLP;
+private:
+ // Enough for well over a second of audio. Editors drain it every frame, and
+ // the AnalysisRegistry's timer drains it when none are open.
+ static constexpr int AnalysisFifoSize = 1 << 16;
+ 
+ AnalysisFifo<NumAnalysisStreams> analysisFifo {AnalysisFifoSize};
+ std::atomic<juce::int64> maximumBlockTicks {0};
+ 
+ juce::SharedResourcePointer<AnalysisRegistry> registry;
+ 
+ // The rate prepareToPlay was last given, and the one the histories are
+ // sized for. Only the drain resizes them, so they never change under a
+ // scope which is reading them.
+ std::atomic<double> pendingSampleRate {44100.};
+ double historySampleRate {0.};
+ void setHistorySampleRate(double sampleRate);
+ 
+ juce::CriticalSection trackNameLock;
+ juce::String trackName;
+ 
+ // Left and right run through the crossover side by side, a block at a
+ // time, into bandBuffer. Its channels are the band streams, starting at
+ // LeftBassStream.
+ Crossover<4, 3, 2> crossover;
+ juce::AudioBuffer<float> bandBuffer;
  //==============================================================================
  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (XDLightScopeAudioProcessor)
 };
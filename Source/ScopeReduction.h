@@ -0,0 +1,343 @@
+/*
+ ==============================================================================
+
+ ScopeReduction.h
+ Created: 16 Oct 2026 2:05:47pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <cstddef>
+#include "SummaryPyramid.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define XDLS_REDUCTION_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define XDLS_REDUCTION_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define XDLS_REDUCTION_NEON 1
+#endif
+
+//==============================================================================
+/*
+ Min/max and band peak reduction over contiguous spans, or evenly spaced
+ blocks, of samples. The vector paths are picked at compile time,
+ reduceSpanScalar is always available and produces identical results.
+ */
+namespace ScopeReduction
+{
+
+#if XDLS_REDUCTION_AVX2 || XDLS_REDUCTION_SSE2 || XDLS_REDUCTION_NEON
+#define XDLS_REDUCTION_VECTOR 1
+
+// Keeps one running bin per vector lane
+struct VectorAccumulator
+{
+#if XDLS_REDUCTION_AVX2
+ static constexpr int Lanes = 8;
+ using Vector = __m256;
+ static Vector splat(float v) { return _mm256_set1_ps(v); }
+ static Vector load(const float *p) { return _mm256_loadu_ps(p); }
+ static Vector min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+ static Vector max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+ static Vector abs(Vector a) { return _mm256_and_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff))); }
+ static void store(float *p, Vector a) { _mm256_storeu_ps(p, a); }
+#elif XDLS_REDUCTION_SSE2
+ static constexpr int Lanes = 4;
+ using Vector = __m128;
+ static Vector splat(float v) { return _mm_set1_ps(v); }
+ static Vector load(const float *p) { return _mm_loadu_ps(p); }
+ static Vector min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+ static Vector max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+ static Vector abs(Vector a) { return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff))); }
+ static void store(float *p, Vector a) { _mm_storeu_ps(p, a); }
+#else
+ static constexpr int Lanes = 4;
+ using Vector = float32x4_t;
+ static Vector splat(float v) { return vdupq_n_f32(v); }
+ static Vector load(const float *p) { return vld1q_f32(p); }
+ static Vector min(Vector a, Vector b) { return vminq_f32(a, b); }
+ static Vector max(Vector a, Vector b) { return vmaxq_f32(a, b); }
+ static Vector abs(Vector a) { return vabsq_f32(a); }
+ static void store(float *p, Vector a) { vst1q_f32(p, a); }
+#endif
+
+ Vector vMin, vMax, vBass, vMids, vHigh;
+
+ explicit VectorAccumulator(const SummaryBin &start) :
+ vMin(splat(start.min)),
+ vMax(splat(start.max)),
+ vBass(splat(start.bass)),
+ vMids(splat(start.mids)),
+ vHigh(splat(start.high))
+ {}
+
+ void add(const float *wave, const float *bass, const float *mids, const float *high)
+ {
+  const Vector w = load(wave);
+  vMin = min(vMin, w);
+  vMax = max(vMax, w);
+  vBass = max(vBass, abs(load(bass)));
+  vMids = max(vMids, abs(load(mids)));
+  vHigh = max(vHigh, abs(load(high)));
+ }
+
+ // Adds a span of length samples, overlapping the last load with the one
+ // before it, as min and max don't mind seeing a sample twice. Spans
+ // shorter than a vector are merged straight into result.
+ void addPartial(const float *wave, const float *bass, const float *mids, const float *high,
+                 int length, SummaryBin &result);
+
+ void finish(SummaryBin &result) const
+ {
+  float lanes[5][Lanes];
+  store(lanes[0], vMin);
+  store(lanes[1], vMax);
+  store(lanes[2], vBass);
+  store(lanes[3], vMids);
+  store(lanes[4], vHigh);
+  for (int l = 0; l < Lanes; ++l)
+  {
+   result.merge({lanes[0][l], lanes[1][l], lanes[2][l], lanes[3][l], lanes[4][l]});
+  }
+ }
+};
+#endif
+
+inline void reduceSpanScalar(const float *wave,
+                             const float *bass,
+                             const float *mids,
+                             const float *high,
+                             int length,
+                             SummaryBin &result)
+{
+ for (int i = 0; i < length; ++i)
+ {
+  result.merge(SummaryBin::fromSample(wave[i], bass[i], mids[i], high[i]));
+ }
+}
+
+#if XDLS_REDUCTION_VECTOR
+inline void VectorAccumulator::addPartial(const float *wave, const float *bass, const float *mids, const float *high,
+                                          int length, SummaryBin &result)
+{
+ if (length < Lanes)
+ {
+  reduceSpanScalar(wave, bass, mids, high, length, result);
+  return;
+ }
+ for (int i = 0; i + Lanes < length; i += Lanes) add(wave + i, bass + i, mids + i, high + i);
+ const int last = length - Lanes;
+ add(wave + last, bass + last, mids + last, high + last);
+}
+#endif
+
+// Merges length samples into result, which must already hold a valid bin
+inline void reduceSpan(const float *wave,
+                       const float *bass,
+                       const float *mids,
+                       const float *high,
+                       int length,
+                       SummaryBin &result)
+{
+ int i = 0;
+
+#if XDLS_REDUCTION_VECTOR
+ constexpr int Lanes = VectorAccumulator::Lanes;
+ if (length >= Lanes)
+ {
+  VectorAccumulator accumulator(result);
+  for (; i + Lanes <= length; i += Lanes) accumulator.add(wave + i, bass + i, mids + i, high + i);
+  accumulator.finish(result);
+ }
+#endif
+
+ reduceSpanScalar(wave + i, bass + i, mids + i, high + i, length - i, result);
+}
+
+// Merges the frames [first, first + count) of block interleaved streams
+// into result. Each stream pointer addresses the stream's part of the first
+// block, which holds BlockLength frames, and every following block starts
+// blockStride floats further on. One accumulator covers the partial blocks
+// at either end as well as the whole ones.
+template <int BlockLength>
+inline void reduceInterleaved(const float *wave,
+                              const float *bass,
+                              const float *mids,
+                              const float *high,
+                              int first,
+                              int count,
+                              std::ptrdiff_t blockStride,
+                              SummaryBin &result)
+{
+ // Short spans, which are most of them when columns are narrow, usually sit
+ // in one block and so are contiguous in every stream
+ const int inBlock = first % BlockLength;
+ if (inBlock + count <= BlockLength)
+ {
+  const std::ptrdiff_t offset = (first / BlockLength)*blockStride + inBlock;
+  reduceSpan(wave + offset, bass + offset, mids + offset, high + offset, count, result);
+  return;
+ }
+ 
+ // The partial blocks at either end, and the whole blocks between them
+ const int headLength = inBlock == 0 ? 0 : std::min(count, BlockLength - inBlock);
+ const int numBlocks = (count - headLength) / BlockLength;
+ const int tailLength = count - headLength - numBlocks*BlockLength;
+ const std::ptrdiff_t headOffset = (first / BlockLength)*blockStride + inBlock;
+ const std::ptrdiff_t blocksOffset = (first / BlockLength + (inBlock == 0 ? 0 : 1))*blockStride;
+ const std::ptrdiff_t tailOffset = blocksOffset + numBlocks*blockStride;
+ 
+#if XDLS_REDUCTION_VECTOR
+ constexpr int Lanes = VectorAccumulator::Lanes;
+ if (BlockLength % Lanes == 0 && count >= Lanes)
+ {
+  VectorAccumulator accumulator(result);
+  accumulator.addPartial(wave + headOffset, bass + headOffset, mids + headOffset, high + headOffset, headLength, result);
+  for (int b = 0; b < numBlocks; ++b)
+  {
+   const std::ptrdiff_t base = blocksOffset + b*blockStride;
+   for (int i = 0; i < BlockLength; i += Lanes)
+   {
+    accumulator.add(wave + base + i, bass + base + i, mids + base + i, high + base + i);
+   }
+  }
+  accumulator.addPartial(wave + tailOffset, bass + tailOffset, mids + tailOffset, high + tailOffset, tailLength, result);
+  accumulator.finish(result);
+  return;
+ }
+#endif
+ 
+ reduceSpanScalar(wave + headOffset, bass + headOffset, mids + headOffset, high + headOffset, headLength, result);
+ for (int b = 0; b < numBlocks; ++b)
+ {
+  const std::ptrdiff_t base = blocksOffset + b*blockStride;
+  reduceSpanScalar(wave + base, bass + base, mids + base, high + base, BlockLength, result);
+ }
+ reduceSpanScalar(wave + tailOffset, bass + tailOffset, mids + tailOffset, high + tailOffset, tailLength, result);
+}
+
+// Reduces a non-empty span into a fresh bin
+inline SummaryBin reduce(const float *wave,
+                         const float *bass,
+                         const float *mids,
+                         const float *high,
+                         int length)
+{
+ SummaryBin result = SummaryBin::fromSample(wave[0], bass[0], mids[0], high[0]);
+ reduceSpan(wave + 1, bass + 1, mids + 1, high + 1, length - 1, result);
+ return result;
+}
+
+//==============================================================================
+// The same reductions over quantised streams, for PackedFrameRingBuffer.
+// result must already hold a valid bin, or PackedBin::identity().
+
+inline void reducePackedSpan(const int16_t *wave,
+                             const uint8_t *bass,
+                             const uint8_t *mids,
+                             const uint8_t *high,
+                             int length,
+                             PackedBin &result)
+{
+ for (int i = 0; i < length; ++i) result.merge({wave[i], wave[i], bass[i], mids[i], high[i], 0});
+}
+
+// Merges numBlocks whole blocks of blockLength samples, with the waveform's
+// blocks waveStride int16s apart and the bands' bandStride bytes apart.
+// Sixteen samples of every stream fit a vector at a time, two for the
+// waveform.
+inline void reducePackedBlocks(const int16_t *wave,
+                               const uint8_t *bass,
+                               const uint8_t *mids,
+                               const uint8_t *high,
+                               int blockLength,
+                               int numBlocks,
+                               std::ptrdiff_t waveStride,
+                               std::ptrdiff_t bandStride,
+                               PackedBin &result)
+{
+#if XDLS_REDUCTION_AVX2 || XDLS_REDUCTION_SSE2
+ if (blockLength % 16 == 0)
+ {
+  __m128i vMin = _mm_set1_epi16(result.min);
+  __m128i vMax = _mm_set1_epi16(result.max);
+  __m128i vBass = _mm_set1_epi8(static_cast<char>(result.bass));
+  __m128i vMids = _mm_set1_epi8(static_cast<char>(result.mids));
+  __m128i vHigh = _mm_set1_epi8(static_cast<char>(result.high));
+  auto load = [](const void *p) { return _mm_loadu_si128(static_cast<const __m128i*>(p)); };
+  for (int b = 0; b < numBlocks; ++b)
+  {
+   const int16_t *w = wave + b*waveStride;
+   const std::ptrdiff_t band = b*bandStride;
+   for (int i = 0; i < blockLength; i += 16)
+   {
+    const __m128i w0 = load(w + i);
+    const __m128i w1 = load(w + i + 8);
+    vMin = _mm_min_epi16(vMin, _mm_min_epi16(w0, w1));
+    vMax = _mm_max_epi16(vMax, _mm_max_epi16(w0, w1));
+    vBass = _mm_max_epu8(vBass, load(bass + band + i));
+    vMids = _mm_max_epu8(vMids, load(mids + band + i));
+    vHigh = _mm_max_epu8(vHigh, load(high + band + i));
+   }
+  }
+  
+  int16_t mins[8], maxes[8];
+  uint8_t bands[3][16];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(mins), vMin);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(maxes), vMax);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(bands[0]), vBass);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(bands[1]), vMids);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(bands[2]), vHigh);
+  for (int l = 0; l < 16; ++l) result.merge({mins[l/2], maxes[l/2], bands[0][l], bands[1][l], bands[2][l], 0});
+  return;
+ }
+#elif XDLS_REDUCTION_NEON
+ if (blockLength % 16 == 0)
+ {
+  int16x8_t vMin = vdupq_n_s16(result.min);
+  int16x8_t vMax = vdupq_n_s16(result.max);
+  uint8x16_t vBass = vdupq_n_u8(result.bass);
+  uint8x16_t vMids = vdupq_n_u8(result.mids);
+  uint8x16_t vHigh = vdupq_n_u8(result.high);
+  for (int b = 0; b < numBlocks; ++b)
+  {
+   const int16_t *w = wave + b*waveStride;
+   const std::ptrdiff_t band = b*bandStride;
+   for (int i = 0; i < blockLength; i += 16)
+   {
+    const int16x8_t w0 = vld1q_s16(w + i);
+    const int16x8_t w1 = vld1q_s16(w + i + 8);
+    vMin = vminq_s16(vMin, vminq_s16(w0, w1));
+    vMax = vmaxq_s16(vMax, vmaxq_s16(w0, w1));
+    vBass = vmaxq_u8(vBass, vld1q_u8(bass + band + i));
+    vMids = vmaxq_u8(vMids, vld1q_u8(mids + band + i));
+    vHigh = vmaxq_u8(vHigh, vld1q_u8(high + band + i));
+   }
+  }
+  
+  int16_t mins[8], maxes[8];
+  uint8_t bands[3][16];
+  vst1q_s16(mins, vMin);
+  vst1q_s16(maxes, vMax);
+  vst1q_u8(bands[0], vBass);
+  vst1q_u8(bands[1], vMids);
+  vst1q_u8(bands[2], vHigh);
+  for (int l = 0; l < 16; ++l) result.merge({mins[l/2], maxes[l/2], bands[0][l], bands[1][l], bands[2][l], 0});
+  return;
+ }
+#endif
+
+ for (int b = 0; b < numBlocks; ++b)
+ {
+  reducePackedSpan(wave + b*waveStride, bass + b*bandStride, mids + b*bandStride, high + b*bandStride, blockLength, result);
+ }
+}
+
+}
@@ -0,0 +1,142 @@
+/*
+ ==============================================================================
+
+ ScopeRenderThread.h
+ Created: 22 Oct 2026 2:41:19pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "AnalysisRegistry.h"
+
+// Editors draw their scopes on the message thread unless the project says
+// otherwise
+#ifndef XDLS_THREADED_RENDERING
+#define XDLS_THREADED_RENDERING 0
+#endif
+
+//==============================================================================
+/*
+ Two images, one being shown and one being drawn, handed between one
+ drawing thread and the message thread without locking. A finished frame
+ is only swapped in when the message thread takes it, and the drawing
+ thread can't start another until it has, so neither image is ever touched
+ by both threads at once.
+ */
+class DoubleBufferedImage
+{
+ juce::Image images[2];
+
+ // Bit 0 is the index of the image being shown, Ready is set while the
+ // other one holds a finished frame
+ static constexpr int Ready = 2;
+ std::atomic<int> state {0};
+
+public:
+ // Drawing thread. Returns the image to draw into, or nullptr while the
+ // last finished frame is still waiting to be taken.
+ juce::Image *beginFrame()
+ {
+  const int s = state.load(std::memory_order_acquire);
+  if (s & Ready) return nullptr;
+  return &images[(s & 1) ^ 1];
+ }
+
+ // Drawing thread, once the image from beginFrame holds a whole frame
+ void finishFrame()
+ { state.fetch_or(Ready, std::memory_order_release); }
+
+ // Message thread. Swaps in the finished frame if there is one, returning
+ // true if there was.
+ bool takeFrame()
+ {
+  const int s = state.load(std::memory_order_acquire);
+  if (!(s & Ready)) return false;
+  state.store((s & 1) ^ 1, std::memory_order_release);
+  return true;
+ }
+
+ bool isFrameReady() const
+ { return (state.load(std::memory_order_acquire) & Ready) != 0; }
+
+ // Message thread. The image most recently taken.
+ const juce::Image &getShownImage() const
+ { return images[state.load(std::memory_order_acquire) & 1]; }
+};
+
+//==============================================================================
+/*
+ One thread, shared by every scope in the process through a
+ SharedResourcePointer, which draws the frames that scopes have asked for
+ into off-screen images.
+
+ Scope sources read histories which the message thread writes while it
+ drains the AnalysisRegistry, so each client holds the registry's history
+ lock while it reads its source, and lets go of it before it draws.
+ */
+class ScopeRenderThread : private juce::Thread
+{
+public:
+ class Client
+ {
+ public:
+  virtual ~Client() = default;
+
+  // Called on the render thread whenever any client has asked for a frame.
+  // Clients with nothing to draw return straight away.
+  virtual void renderFrame(const juce::CriticalSection &sourceLock) = 0;
+ };
+
+ ScopeRenderThread() :
+ juce::Thread("Scope renderer")
+ {
+  startThread();
+ }
+
+ ~ScopeRenderThread() override
+ {
+  stopThread(10000);
+ }
+
+ void addClient(Client *client)
+ {
+  const juce::ScopedLock sl(clientLock);
+  clients.addIfNotAlreadyThere(client);
+ }
+
+ // Waits for a frame the client is drawing to finish first
+ void removeClient(Client *client)
+ {
+  const juce::ScopedLock sl(clientLock);
+  clients.removeFirstMatchingValue(client);
+ }
+
+ // Call from any thread once a client has something to draw
+ void wake()
+ { notify(); }
+
+private:
+ juce::SharedResourcePointer<AnalysisRegistry> registry;
+ juce::CriticalSection clientLock;
+ juce::Array<Client*> clients;
+
+ void run() override
+ {
+  while (!threadShouldExit())
+  {
+   wait(-1);
+
+   const juce::ScopedLock sl(clientLock);
+   for (auto *client: clients)
+   {
+    if (threadShouldExit()) break;
+    client->renderFrame(registry->getHistoryLock());
+   }
+  }
+ }
+};
@@ -0,0 +1,126 @@
+/*
+ ==============================================================================
+
+ SpanRasteriser.h
+ Created: 19 Oct 2026 1:37:50pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+// One column of a waveform, in pixels from the top of the image
+struct ScopeSpan
+{
+ float top;
+ float bottom;
+ juce::PixelARGB colour;
+};
+
+//==============================================================================
+/*
+ Draws a waveform as one vertical span per pixel column straight into an
+ image's pixels, which is all the edge table rasteriser ends up doing for a
+ filled waveform path, without building or scanning the edge table.
+
+ Span edges can be anti-aliased by pixel coverage. The outline pass
+ draws the top and bottom edges as a line outlineWidth thick, joining each
+ column to the one before it, in the column's colour.
+ */
+class SpanRasteriser
+{
+ template <typename PixelType>
+ struct Target
+ {
+  juce::Image::BitmapData &data;
+  bool antialias;
+
+  PixelType *pixel(int x, int y) const
+  { return reinterpret_cast<PixelType*>(data.getPixelPointer(x, y)); }
+
+  void fill(int x, float top, float bottom, const juce::PixelARGB &colour) const
+  {
+   top = std::max(top, 0.f);
+   bottom = std::min(bottom, static_cast<float>(data.height));
+   if (bottom <= top) return;
+
+   if (!antialias)
+   {
+    const int last = juce::roundToInt(bottom);
+    for (int y = juce::roundToInt(top); y < last; ++y) pixel(x, y)->set(colour);
+    return;
+   }
+
+   const int first = static_cast<int>(top);
+   const int last = static_cast<int>(std::ceil(bottom)) - 1;
+   if (first == last)
+   {
+    pixel(x, first)->blend(colour, coverage(bottom - top));
+    return;
+   }
+
+   pixel(x, first)->blend(colour, coverage(static_cast<float>(first + 1) - top));
+   for (int y = first + 1; y < last; ++y) pixel(x, y)->set(colour);
+   pixel(x, last)->blend(colour, coverage(bottom - static_cast<float>(last)));
+  }
+
+  static juce::uint32 coverage(float amount)
+  { return static_cast<juce::uint32>(juce::jlimit(0, 255, juce::roundToInt(amount*255.f))); }
+ };
+
+ template <typename PixelType>
+ void renderInto(juce::Image::BitmapData &data, const ScopeSpan *spans, int first, int end) const
+ {
+  const Target<PixelType> target {data, antialias};
+  first = std::max(first, 0);
+  end = std::min(end, data.width);
+  if (fill)
+  {
+   for (int x = first; x < end; ++x) target.fill(x, spans[x].top, spans[x].bottom, spans[x].colour);
+  }
+
+  if (outlineWidth > 0.f)
+  {
+   const float halfWidth = 0.5f*outlineWidth;
+   for (int x = first; x < end; ++x)
+   {
+    const ScopeSpan &previous = spans[std::max(x - 1, 0)];
+    const ScopeSpan &span = spans[x];
+    target.fill(x,
+                std::min(previous.top, span.top) - halfWidth,
+                std::max(previous.top, span.top) + halfWidth,
+                span.colour);
+    target.fill(x,
+                std::min(previous.bottom, span.bottom) - halfWidth,
+                std::max(previous.bottom, span.bottom) + halfWidth,
+                span.colour);
+   }
+  }
+ }
+
+public:
+ bool fill {true};
+ bool antialias {true};
+
+ // Zero turns the outline off
+ float outlineWidth {0.f};
+
+ // Draws spans[x] into column x of an RGB or ARGB image, over whatever it
+ // already holds. Columns past the end of the image are ignored.
+ void render(juce::Image::BitmapData &data, const ScopeSpan *spans, int numSpans) const
+ { renderColumns(data, spans, 0, numSpans); }
+
+ // Draws only columns [first, end), for redrawing part of an image which
+ // has been cleared there. The outline joins column first to the one
+ // before it, so spans must hold that one too.
+ void renderColumns(juce::Image::BitmapData &data, const ScopeSpan *spans, int first, int end) const
+ {
+  if (data.pixelFormat == juce::Image::RGB) renderInto<juce::PixelRGB>(data, spans, first, end);
+  else if (data.pixelFormat == juce::Image::ARGB) renderInto<juce::PixelARGB>(data, spans, first, end);
+  else jassertfalse;
+ }
+};
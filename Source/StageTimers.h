@@ -0,0 +1,270 @@
+/*
+ ==============================================================================
+
+ StageTimers.h
+ Created: 21 Oct 2026 3:37:50pm
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+// Timing is compiled in for debug builds only unless the project says
+// otherwise. With it off, the macros below expand to nothing.
+#ifndef XDLS_INSTRUMENTATION
+#define XDLS_INSTRUMENTATION JUCE_DEBUG
+#endif
+
+#if XDLS_INSTRUMENTATION
+// Times the rest of the enclosing scope
+#define XDLS_TIME_STAGE(stage) const StageTimers::ScopedTimer xdlsStageTimer (StageTimers::stage)
+// Records a time which has already been measured in high resolution ticks
+#define XDLS_RECORD_STAGE(stage, ticks) StageTimers::get().record(StageTimers::stage, ticks)
+#else
+#define XDLS_TIME_STAGE(stage)
+#define XDLS_RECORD_STAGE(stage, ticks)
+#endif
+
+#if XDLS_INSTRUMENTATION
+//==============================================================================
+/*
+ A histogram of how long each hot stage takes, shared by every instance in
+ the process. Recording a time costs a couple of relaxed atomic adds, so it
+ is safe on the audio thread. Buckets are a quarter of an octave wide, so
+ the percentiles are accurate to within about 19%, and are reported as the
+ top of their bucket.
+ */
+class StageTimers
+{
+public:
+ enum Stage
+ {
+  processBlock,
+  drainAnalysis,
+  scopeUpdate,
+  buildPath,
+  rasteriseSpans,
+  paint,
+  NumStages
+ };
+
+ static constexpr int BucketsPerOctave = 4;
+ static constexpr int NumBuckets = 40*BucketsPerOctave;
+
+ struct Summary
+ {
+  juce::int64 count;
+  // Seconds
+  double p50;
+  double p99;
+  double maximum;
+ };
+
+ using Snapshot = std::array<Summary, NumStages>;
+
+ // All the counters start at zero, so this needs no locking on first use
+ static StageTimers &get()
+ {
+  static StageTimers timers;
+  return timers;
+ }
+
+ static const char *getStageName(int stage)
+ {
+  static const char *names[NumStages] =
+  {"processBlock", "drainAnalysis", "scopeUpdate", "buildPath", "rasteriseSpans", "paint"};
+  return names[stage];
+ }
+
+ class ScopedTimer
+ {
+  Stage stage;
+  juce::int64 start;
+
+ public:
+  explicit ScopedTimer(Stage timedStage) :
+  stage(timedStage),
+  start(juce::Time::getHighResolutionTicks())
+  {}
+
+  ~ScopedTimer()
+  { get().record(stage, juce::Time::getHighResolutionTicks() - start); }
+ };
+
+ void record(Stage stage, juce::int64 ticks)
+ {
+  const auto nanoseconds = static_cast<juce::uint64>(juce::Time::highResolutionTicksToSeconds(std::max<juce::int64>(ticks, 0))*1e9);
+  auto &histogram = histograms[stage];
+  histogram.counts[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+  auto maximum = histogram.maximum.load(std::memory_order_relaxed);
+  while (nanoseconds > maximum &&
+         !histogram.maximum.compare_exchange_weak(maximum, nanoseconds, std::memory_order_relaxed)) {}
+ }
+
+ // Summarises every stage, and starts again from empty if reset is set
+ Snapshot takeSnapshot(bool reset)
+ {
+  Snapshot snapshot;
+  for (int stage = 0; stage < NumStages; ++stage)
+  {
+   auto &histogram = histograms[stage];
+   std::array<juce::uint32, NumBuckets> counts;
+   juce::int64 total = 0;
+   for (int b = 0; b < NumBuckets; ++b)
+   {
+    counts[b] = reset ? histogram.counts[b].exchange(0, std::memory_order_relaxed)
+    : histogram.counts[b].load(std::memory_order_relaxed);
+    total += counts[b];
+   }
+   const auto maximum = reset ? histogram.maximum.exchange(0, std::memory_order_relaxed)
+   : histogram.maximum.load(std::memory_order_relaxed);
+
+   snapshot[stage] = {total, percentile(counts, total, 0.5), percentile(counts, total, 0.99), maximum*1e-9};
+  }
+  return snapshot;
+ }
+
+ static juce::String toJSON(const Snapshot &snapshot)
+ {
+  juce::Array<juce::var> stages;
+  for (int stage = 0; stage < NumStages; ++stage)
+  {
+   auto *object = new juce::DynamicObject();
+   object->setProperty("stage", getStageName(stage));
+   object->setProperty("count", snapshot[stage].count);
+   object->setProperty("p50", snapshot[stage].p50);
+   object->setProperty("p99", snapshot[stage].p99);
+   object->setProperty("max", snapshot[stage].maximum);
+   stages.add(juce::var(object));
+  }
+  return juce::JSON::toString(juce::var(stages));
+ }
+
+ // Times are in microseconds
+ static juce::String toCSV(const Snapshot &snapshot)
+ {
+  juce::String csv("stage,count,p50_us,p99_us,max_us\n");
+  for (int stage = 0; stage < NumStages; ++stage)
+  {
+   csv << getStageName(stage) << "," << snapshot[stage].count << ","
+   << juce::String(snapshot[stage].p50*1e6, 2) << ","
+   << juce::String(snapshot[stage].p99*1e6, 2) << ","
+   << juce::String(snapshot[stage].maximum*1e6, 2) << "\n";
+  }
+  return csv;
+ }
+
+private:
+ struct Histogram
+ {
+  std::array<std::atomic<juce::uint32>, NumBuckets> counts {};
+  std::atomic<juce::uint64> maximum {0};
+ };
+
+ std::array<Histogram, NumStages> histograms {};
+
+ // Bucket b covers [2^(b/4), 2^((b + 1)/4)) nanoseconds, near enough
+ static int bucketFor(juce::uint64 nanoseconds)
+ {
+  if (nanoseconds < 4) return static_cast<int>(nanoseconds);
+  int octave = 0;
+  while ((nanoseconds >> (octave + 1)) != 0) ++octave;
+  const int step = static_cast<int>((nanoseconds >> (octave - 2)) & 3);
+  return std::min(NumBuckets - 1, octave*BucketsPerOctave + step);
+ }
+
+ // The top of bucket b, in seconds
+ static double bucketTop(int b)
+ {
+  if (b < 4) return (b + 1)*1e-9;
+  const int octave = b / BucketsPerOctave;
+  const int step = b % BucketsPerOctave;
+  return std::ldexp(5. + step, octave - 2)*1e-9;
+ }
+
+ static double percentile(const std::array<juce::uint32, NumBuckets> &counts, juce::int64 total, double fraction)
+ {
+  if (total == 0) return 0.;
+  const auto rank = static_cast<juce::int64>(std::ceil(fraction*static_cast<double>(total)));
+  juce::int64 seen = 0;
+  for (int b = 0; b < NumBuckets; ++b)
+  {
+   seen += counts[b];
+   if (seen >= rank) return bucketTop(b);
+  }
+  return bucketTop(NumBuckets - 1);
+ }
+};
+
+//==============================================================================
+/*
+ Shows the stage timings over the last second as a table, with buttons
+ which copy them to the clipboard as JSON or CSV.
+ */
+class StageTimerOverlay : public juce::Component, private juce::Timer
+{
+ StageTimers::Snapshot snapshot {};
+ juce::TextButton jsonButton {"JSON"};
+ juce::TextButton csvButton {"CSV"};
+
+ void timerCallback() override
+ {
+  snapshot = StageTimers::get().takeSnapshot(true);
+  repaint();
+ }
+
+public:
+ StageTimerOverlay()
+ {
+  setInterceptsMouseClicks(false, true);
+  addAndMakeVisible(jsonButton);
+  addAndMakeVisible(csvButton);
+  jsonButton.onClick = [this]() { juce::SystemClipboard::copyTextToClipboard(StageTimers::toJSON(snapshot)); };
+  csvButton.onClick = [this]() { juce::SystemClipboard::copyTextToClipboard(StageTimers::toCSV(snapshot)); };
+  startTimer(1000);
+ }
+
+ void paint(juce::Graphics &g) override
+ {
+  g.fillAll(juce::Colours::black.withAlpha(0.75f));
+  g.setColour(juce::Colours::yellow);
+  g.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 11.f, juce::Font::plain));
+
+  auto row = getLocalBounds().reduced(4, 2).removeFromTop(14);
+  auto line = [&](const juce::String &stage, const juce::String &count, const juce::String &p50,
+                  const juce::String &p99, const juce::String &maximum)
+  {
+   auto cells = row;
+   g.drawText(stage, cells.removeFromLeft(100), juce::Justification::centredLeft);
+   g.drawText(count, cells.removeFromLeft(56), juce::Justification::centredRight);
+   g.drawText(p50, cells.removeFromLeft(72), juce::Justification::centredRight);
+   g.drawText(p99, cells.removeFromLeft(72), juce::Justification::centredRight);
+   g.drawText(maximum, cells.removeFromLeft(72), juce::Justification::centredRight);
+   row.translate(0, row.getHeight());
+  };
+
+  auto micros = [](double seconds) { return juce::String(seconds*1e6, 1) + "us"; };
+  line("stage", "count", "p50", "p99", "max");
+  for (int stage = 0; stage < StageTimers::NumStages; ++stage)
+  {
+   line(StageTimers::getStageName(stage), juce::String(snapshot[stage].count),
+        micros(snapshot[stage].p50), micros(snapshot[stage].p99), micros(snapshot[stage].maximum));
+  }
+ }
+
+ void resized() override
+ {
+  auto buttons = getLocalBounds().removeFromTop(18).removeFromRight(100).reduced(2);
+  csvButton.setBounds(buttons.removeFromRight(48));
+  jsonButton.setBounds(buttons.removeFromRight(48));
+ }
+
+private:
+ JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (StageTimerOverlay)
+};
+#endif
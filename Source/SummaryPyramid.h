@@ -0,0 +1,315 @@
+/*
+ ==============================================================================
+
+ SummaryPyramid.h
+ Created: 16 Oct 2026 11:40:31am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//==============================================================================
+/*
+ The reduction of a range of samples which a scope needs to draw one column:
+ the waveform extremes and the peak magnitude of each crossover band.
+ */
+struct SummaryBin
+{
+ float min;
+ float max;
+ float bass;
+ float mids;
+ float high;
+
+ static SummaryBin fromSample(float sample, float bass, float mids, float high)
+ {
+  return {sample, sample, std::fabs(bass), std::fabs(mids), std::fabs(high)};
+ }
+
+ void merge(const SummaryBin &other)
+ {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  bass = std::max(bass, other.bass);
+  mids = std::max(mids, other.mids);
+  high = std::max(high, other.high);
+ }
+ 
+ // The conversions PackedBin needs, so either can be stored in a pyramid
+ static SummaryBin fromSummary(const SummaryBin &bin)
+ { return bin; }
+ 
+ SummaryBin toSummary() const
+ { return *this; }
+};
+
+//==============================================================================
+/*
+ Quantisation for the compact history. Waveforms are stored to 1/16384,
+ clipping at +-2. Band magnitudes are stored on a log scale with 16 steps
+ per octave, from 4 (+12dBFS) down to about -84dBFS, and 0 below that. The
+ codes are the top bits of the float itself, so no log is needed.
+
+ Both mappings are monotonic, so the min, max or peak of a run of codes is
+ the code of the min, max or peak of the samples. Reductions can work on
+ the codes and only decode the result.
+ */
+namespace Quantise
+{
+
+constexpr float WaveScale = 16384.f;
+constexpr int MagnitudeShift = 19;
+// Code 255 is the step holding 4.f
+constexpr int MagnitudeOffset = (0x40800000 >> MagnitudeShift) - 255;
+
+inline int16_t wave(float sample)
+{
+ const float clipped = std::min(std::max(sample, -2.f), 2.f - 1.f/WaveScale);
+ return static_cast<int16_t>(std::lrint(clipped*WaveScale));
+}
+
+inline float wave(int16_t code)
+{ return static_cast<float>(code)*(1.f/WaveScale); }
+
+inline uint8_t magnitude(float value)
+{
+ uint32_t bits;
+ std::memcpy(&bits, &value, sizeof(bits));
+ const int code = static_cast<int>((bits & 0x7fffffff) >> MagnitudeShift) - MagnitudeOffset;
+ return static_cast<uint8_t>(std::min(std::max(code, 0), 255));
+}
+
+// Decodes to the middle of the code's step
+inline float magnitude(uint8_t code)
+{
+ if (code == 0) return 0.f;
+ const uint32_t bits = (static_cast<uint32_t>(code + MagnitudeOffset) << MagnitudeShift) | (1u << (MagnitudeShift - 1));
+ float value;
+ std::memcpy(&value, &bits, sizeof(value));
+ return value;
+}
+
+}
+
+//==============================================================================
+// A SummaryBin quantised to eight bytes
+struct PackedBin
+{
+ int16_t min;
+ int16_t max;
+ uint8_t bass;
+ uint8_t mids;
+ uint8_t high;
+ uint8_t unused;
+ 
+ // Merging anything into this replaces it
+ static PackedBin identity()
+ { return {INT16_MAX, INT16_MIN, 0, 0, 0, 0}; }
+ 
+ static PackedBin fromSummary(const SummaryBin &bin)
+ {
+  return {Quantise::wave(bin.min), Quantise::wave(bin.max),
+   Quantise::magnitude(bin.bass), Quantise::magnitude(bin.mids), Quantise::magnitude(bin.high), 0};
+ }
+ 
+ SummaryBin toSummary() const
+ {
+  return {Quantise::wave(min), Quantise::wave(max),
+   Quantise::magnitude(bass), Quantise::magnitude(mids), Quantise::magnitude(high)};
+ }
+ 
+ void merge(const PackedBin &other)
+ {
+  min = std::min(min, other.min);
+  max = std::max(max, other.max);
+  bass = std::max(bass, other.bass);
+  mids = std::max(mids, other.mids);
+  high = std::max(high, other.high);
+ }
+};
+
+
+
+
+
+
+
+
+
+
+//==============================================================================
+/*
+ Multi-resolution summary of a stream of samples. Level k holds one bin for
+ every 2^k samples, aligned to the absolute sample position, in a ring. Bins
+ are completed as samples arrive, at an amortised cost of two merges per
+ sample.
+
+ The rings of the lower levels cover the full rate history, which the
+ caller keeps the samples of. Above that every level keeps the same number
+ of bins, so each one reaches twice as far back as the one below and the
+ memory needed grows with the log of the history length. Further back, a
+ range is only resolved to the bins of the finest level still holding it.
+
+ Individual samples are not stored. Queries ask the caller for the few
+ unaligned samples at the ends of a range, everything else is covered by
+ O(log n) bins.
+
+ Bins are stored as Bin, either SummaryBin or PackedBin, and queries
+ convert to and from SummaryBin at the edges.
+ */
+template <typename Bin>
+class BasicSummaryPyramid
+{
+ // levels[k - 1] holds the bins of level k
+ std::vector<std::vector<Bin>> levels;
+ std::vector<int64_t> masks;
+ Bin previousSample {Bin::fromSummary({0.f, 0.f, 0.f, 0.f, 0.f})};
+ int64_t totalSamples {0};
+ int64_t rawLength {0};
+ int64_t historyLength {0};
+ 
+ // Whether the bin of level holding position is complete and still in its
+ // ring. Level 0 is the caller's full rate history.
+ bool isAvailable(int level, int64_t position) const
+ {
+  if (level == 0) return totalSamples - position <= rawLength;
+  const int64_t index = position >> level;
+  const int64_t completed = totalSamples >> level;
+  return index < completed && completed - index <= masks[level - 1] + 1;
+ }
+
+ void complete(int level, int64_t position, Bin bin)
+ {
+  // position is the absolute index of the last sample in the completed bin
+  const int numLevels = static_cast<int>(levels.size());
+  while (true)
+  {
+   const int64_t index = position >> level;
+   levels[level - 1][index & masks[level - 1]] = bin;
+
+   // Only odd numbered bins complete a bin in the next level up
+   if (!(index & 1) || level == numLevels) return;
+   Bin parent = levels[level - 1][(index - 1) & masks[level - 1]];
+   parent.merge(bin);
+   bin = parent;
+   ++level;
+  }
+ }
+
+public:
+ // Sizes the pyramid to cover the fullRateLength samples the caller keeps
+ // at full resolution, then summaries reaching back at least longLength
+ // samples with tierBins bins (a power of two) per level. Treats the history
+ // as if it was filled with silence.
+ void setMaximumLength(int fullRateLength, int64_t longLength = 0, int tierBins = 4096)
+ {
+  int64_t capacity = 2;
+  while (capacity < fullRateLength) capacity <<= 1;
+  
+  // Without a long history the top level is a single bin
+  const bool tiered = longLength > capacity;
+  std::vector<int64_t> binCounts;
+  int64_t coverage = capacity;
+  for (int k = 1; (capacity >> k) > 0 || (tiered && coverage < longLength); ++k)
+  {
+   binCounts.push_back(tiered ? std::max<int64_t>(capacity >> k, tierBins) : capacity >> k);
+   coverage = std::max(coverage, binCounts.back() << k);
+  }
+  
+  const int numLevels = static_cast<int>(binCounts.size());
+  levels.resize(numLevels);
+  masks.resize(numLevels);
+  for (int k = 1; k <= numLevels; ++k)
+  {
+   levels[k - 1].assign(static_cast<size_t>(binCounts[k - 1]), Bin::fromSummary({0.f, 0.f, 0.f, 0.f, 0.f}));
+   masks[k - 1] = binCounts[k - 1] - 1;
+  }
+
+  previousSample = Bin::fromSummary({0.f, 0.f, 0.f, 0.f, 0.f});
+  rawLength = fullRateLength;
+  historyLength = coverage;
+  totalSamples = historyLength;
+ }
+ 
+ // How far back, in samples, a query can reach
+ int64_t getHistoryLength() const
+ { return historyLength; }
+
+ void tapIn(float sample, float bass, float mids, float high)
+ {
+  const Bin bin = Bin::fromSummary(SummaryBin::fromSample(sample, bass, mids, high));
+  if (totalSamples & 1)
+  {
+   Bin pair = previousSample;
+   pair.merge(bin);
+   complete(1, totalSamples, pair);
+  }
+  else previousSample = bin;
+  ++totalSamples;
+ }
+
+ // The absolute position of the next sample to be written
+ int64_t getTotalSamples() const
+ { return totalSamples; }
+
+ // Reduces the absolute range [first, last). The range must lie within the
+ // history the pyramid was sized for. rawSample(position) is called for the
+ // samples within the full rate history which do not fill a whole bin, and
+ // must return their SummaryBin. Beyond the full rate history the ends of
+ // the range are widened to the bins of the finest level holding them.
+ template <typename RawSample>
+ SummaryBin query(int64_t first, int64_t last, RawSample &&rawSample) const
+ {
+  const int numLevels = static_cast<int>(levels.size());
+  Bin result {Bin::fromSummary({0.f, 0.f, 0.f, 0.f, 0.f})};
+  bool empty = true;
+  auto add = [&](const Bin &bin)
+  {
+   if (empty) result = bin;
+   else result.merge(bin);
+   empty = false;
+  };
+  
+  int64_t position = first;
+  while (position < last)
+  {
+   // The biggest aligned bin which fits. Coarser levels reach further back,
+   // so if that one has already left its ring, so has every finer one.
+   int level = 0;
+   while (level < numLevels &&
+          !(position & ((int64_t(2) << level) - 1)) &&
+          position + (int64_t(2) << level) <= last) ++level;
+   
+   if (!isAvailable(level, position))
+   {
+    while (level < numLevels && !isAvailable(level, position)) ++level;
+    if (!isAvailable(level, position)) break;
+    add(levels[level - 1][(position >> level) & masks[level - 1]]);
+    position = ((position >> level) + 1) << level;
+   }
+   else if (level == 0)
+   {
+    add(Bin::fromSummary(rawSample(position)));
+    ++position;
+   }
+   else
+   {
+    add(levels[level - 1][(position >> level) & masks[level - 1]]);
+    position += int64_t(1) << level;
+   }
+  }
+
+  return result.toSummary();
+ }
+};
+
+using SummaryPyramid = BasicSummaryPyramid<SummaryBin>;
+using PackedSummaryPyramid = BasicSummaryPyramid<PackedBin>;
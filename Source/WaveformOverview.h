@@ -0,0 +1,310 @@
+/*
+ ==============================================================================
+
+ WaveformOverview.h
+ Created: 17 Oct 2026 9:47:53am
+ Author:  Adam Jackson
+
+ ==============================================================================
+ */
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "BandSplitter.h"
+#include "ChunkedAnalyser.h"
+
+//==============================================================================
+/*
+ A precomputed, multi-resolution summary of a whole audio file, stored on
+ disk and memory mapped when it is used. Level k holds one SummaryBin for
+ every 2^(BaseBinShift + k) samples of the mono mix, with the band peaks
+ taken from the same crossover that AudioFileScopeSource uses.
+
+ Files are identified by the audio file's ParallelAnalyser::fingerprint,
+ which also covers the crossover frequencies, so a stale overview is never
+ used.
+ */
+class WaveformOverview
+{
+ struct FileHeader
+ {
+  char magic[8];
+  juce::uint32 version;
+  juce::uint32 numLevels;
+  juce::uint8 fingerprint[16];
+  double sampleRate;
+  juce::int64 lengthInSamples;
+ };
+
+ struct LevelHeader
+ {
+  juce::int64 binSize;
+  juce::int64 numBins;
+  juce::int64 dataOffset;
+ };
+
+ struct Level
+ {
+  juce::int64 binSize;
+  juce::int64 numBins;
+  const SummaryBin *bins;
+ };
+
+ static constexpr char Magic[8] = {'X', 'D', 'L', 'S', 'O', 'V', 'W', '1'};
+
+ std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+ std::vector<Level> levels;
+ double sampleRate {0.};
+ juce::int64 lengthInSamples {0};
+
+public:
+ static constexpr juce::uint32 FormatVersion = 2;
+ static constexpr int BaseBinShift = 8;
+
+ //==============================================================================
+ static juce::MD5 fingerprint(const juce::File &audioFile, float lowCrossover, float highCrossover)
+ {
+  juce::MemoryOutputStream settings;
+  settings.writeFloat(lowCrossover);
+  settings.writeFloat(highCrossover);
+  settings.writeInt(static_cast<int>(FormatVersion));
+  return ParallelAnalyser::fingerprint(audioFile, settings.getMemoryBlock());
+ }
+
+ static juce::File getDefaultCacheDirectory()
+ {
+  return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+  .getChildFile("XDMakesMusic")
+  .getChildFile("XDLightScope")
+  .getChildFile("Overviews");
+ }
+
+ // Pass an invalid cache directory to keep the overview next to the track
+ static juce::File getCacheFile(const juce::File &audioFile,
+                                const juce::MD5 &fileFingerprint,
+                                const juce::File &cacheDirectory)
+ {
+  if (cacheDirectory == juce::File()) return audioFile.getSiblingFile(audioFile.getFileName() + ".xdov");
+  return cacheDirectory.getChildFile(fileFingerprint.toHexString() + ".xdov");
+ }
+
+ //==============================================================================
+ // Maps an overview file, returning nullptr unless it is complete and matches
+ // the fingerprint
+ static std::unique_ptr<WaveformOverview> load(const juce::File &overviewFile,
+                                               const juce::MD5 &fileFingerprint)
+ {
+  if (!overviewFile.existsAsFile()) return nullptr;
+
+  std::unique_ptr<WaveformOverview> result(new WaveformOverview());
+  result->mappedFile = std::make_unique<juce::MemoryMappedFile>(overviewFile, juce::MemoryMappedFile::readOnly);
+  const auto *data = static_cast<const char*>(result->mappedFile->getData());
+  const size_t size = result->mappedFile->getSize();
+  if (data == nullptr || size < sizeof(FileHeader)) return nullptr;
+
+  FileHeader header;
+  std::memcpy(&header, data, sizeof(FileHeader));
+  if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+      header.version != FormatVersion ||
+      std::memcmp(header.fingerprint, fileFingerprint.getChecksumDataArray(), 16) != 0 ||
+      header.numLevels > (size - sizeof(FileHeader))/sizeof(LevelHeader)) return nullptr;
+
+  result->sampleRate = header.sampleRate;
+  result->lengthInSamples = header.lengthInSamples;
+  for (juce::uint32 k = 0; k < header.numLevels; ++k)
+  {
+   LevelHeader level;
+   std::memcpy(&level, data + sizeof(FileHeader) + k*sizeof(LevelHeader), sizeof(LevelHeader));
+   // Written so that a corrupt header can't overflow the sums
+   if (level.dataOffset < 0 || level.numBins < 1 ||
+       static_cast<juce::uint64>(level.dataOffset) > size ||
+       static_cast<juce::uint64>(level.numBins) > (size - static_cast<size_t>(level.dataOffset))/sizeof(SummaryBin)) return nullptr;
+   result->levels.push_back({level.binSize, level.numBins,
+    reinterpret_cast<const SummaryBin*>(data + level.dataOffset)});
+  }
+
+  if (result->levels.empty()) return nullptr;
+  return result;
+ }
+
+ // Analyses the whole file on the pool, or on the calling thread if pool is
+ // nullptr, and writes the overview to destination. Returns false if it
+ // failed or shouldExit() returned true along the way.
+ template <typename ShouldExit>
+ static bool build(juce::ThreadPool *pool,
+                   const ParallelAnalyser::ReaderFactory &createReader,
+                   float lowCrossover,
+                   float highCrossover,
+                   const juce::MD5 &fileFingerprint,
+                   const juce::File &destination,
+                   ShouldExit &&shouldExit)
+ {
+  constexpr int BaseBinSize = 1 << BaseBinShift;
+  auto reader = createReader();
+  if (!reader) return false;
+  const juce::int64 length = reader->lengthInSamples;
+  const double sampleRate = reader->sampleRate;
+  if (length <= 0) return false;
+
+  BandSplitter splitter;
+  splitter.setSampleRate(sampleRate);
+  splitter.setCrossovers(lowCrossover, highCrossover);
+
+  std::vector<std::vector<SummaryBin>> bins(1);
+  bins[0].resize(static_cast<size_t>((length + BaseBinSize - 1) / BaseBinSize));
+
+  if (!ParallelAnalyser::analyse(pool, createReader, splitter, 0, length,
+                                 BaseBinShift, 0, bins[0].data(), shouldExit)) return false;
+
+  while (bins.back().size() > 1)
+  {
+   const auto &below = bins.back();
+   std::vector<SummaryBin> above((below.size() + 1)/2);
+   for (size_t b = 0; b < above.size(); ++b)
+   {
+    above[b] = below[2*b];
+    if (2*b + 1 < below.size()) above[b].merge(below[2*b + 1]);
+   }
+   bins.push_back(std::move(above));
+  }
+
+  FileHeader header {};
+  std::memcpy(header.magic, Magic, sizeof(Magic));
+  header.version = FormatVersion;
+  header.numLevels = static_cast<juce::uint32>(bins.size());
+  std::memcpy(header.fingerprint, fileFingerprint.getChecksumDataArray(), 16);
+  header.sampleRate = sampleRate;
+  header.lengthInSamples = length;
+
+  if (!destination.getParentDirectory().createDirectory()) return false;
+  juce::TemporaryFile temporary(destination);
+  {
+   juce::FileOutputStream out(temporary.getFile());
+   if (!out.openedOk()) return false;
+
+   out.write(&header, sizeof(header));
+   juce::int64 dataOffset = sizeof(FileHeader) + bins.size()*sizeof(LevelHeader);
+   for (size_t k = 0; k < bins.size(); ++k)
+   {
+    LevelHeader level {juce::int64(BaseBinSize) << k, static_cast<juce::int64>(bins[k].size()), dataOffset};
+    out.write(&level, sizeof(level));
+    dataOffset += static_cast<juce::int64>(bins[k].size()*sizeof(SummaryBin));
+   }
+   for (const auto &level: bins) out.write(level.data(), level.size()*sizeof(SummaryBin));
+
+   out.flush();
+   if (out.getStatus().failed()) return false;
+  }
+
+  return temporary.overwriteTargetFileWithTemporary();
+ }
+
+ //==============================================================================
+ int getNumLevels() const
+ { return static_cast<int>(levels.size()); }
+
+ juce::int64 getBinSize(int level) const
+ { return levels[level].binSize; }
+
+ juce::int64 getNumBins(int level) const
+ { return levels[level].numBins; }
+
+ const SummaryBin *getBins(int level) const
+ { return levels[level].bins; }
+
+ double getSampleRate() const
+ { return sampleRate; }
+
+ juce::int64 getLengthInSamples() const
+ { return lengthInSamples; }
+
+ // Reduces the samples [first, last) using the finest level that needs no
+ // more than a handful of bins. Bins at the ends are included whole.
+ SummaryBin query(juce::int64 first, juce::int64 last) const
+ {
+  size_t level = 0;
+  while (level + 1 < levels.size() && 2*levels[level + 1].binSize <= last - first) ++level;
+
+  const Level &l = levels[level];
+  const juce::int64 firstBin = juce::jlimit<juce::int64>(0, l.numBins - 1, first / l.binSize);
+  const juce::int64 lastBin = juce::jlimit<juce::int64>(firstBin, l.numBins - 1, (last - 1) / l.binSize);
+  SummaryBin result = l.bins[firstBin];
+  for (juce::int64 b = firstBin + 1; b <= lastBin; ++b) result.merge(l.bins[b]);
+  return result;
+ }
+
+ //==============================================================================
+ // Builds overviews in the background. Shared by every source in the process.
+ struct BuildPool
+ {
+  juce::ThreadPool pool {1};
+  
+  // Overviews which couldn't be built this session, for instance because
+  // they go next to tracks on read only media, so opening the file again
+  // doesn't analyse it all over again
+  void markFailed(const juce::File &overviewFile, const juce::MD5 &fileFingerprint)
+  {
+   const juce::ScopedLock sl(failedLock);
+   failed.addIfNotAlreadyThere(key(overviewFile, fileFingerprint));
+  }
+  
+  bool hasFailed(const juce::File &overviewFile, const juce::MD5 &fileFingerprint) const
+  {
+   const juce::ScopedLock sl(failedLock);
+   return failed.contains(key(overviewFile, fileFingerprint));
+  }
+  
+ private:
+  juce::CriticalSection failedLock;
+  juce::StringArray failed;
+  
+  static juce::String key(const juce::File &overviewFile, const juce::MD5 &fileFingerprint)
+  { return overviewFile.getFullPathName() + ":" + fileFingerprint.toHexString(); }
+ };
+
+ class BuildJob : public juce::ThreadPoolJob
+ {
+  juce::File audioFile;
+  juce::File destination;
+  juce::MD5 fileFingerprint;
+  float lowCrossover;
+  float highCrossover;
+  std::shared_ptr<std::atomic<bool>> succeeded;
+  std::shared_ptr<std::atomic<bool>> finished;
+  std::shared_ptr<std::atomic<bool>> cancelled;
+  juce::SharedResourcePointer<ParallelAnalyser::Pool> analysisPool;
+
+ public:
+  // succeededFlag is set before finishedFlag, if the overview was written.
+  // Setting cancelFlag abandons the build, whether it has started or not,
+  // without leaving a partial overview behind.
+  BuildJob(const juce::File &audio,
+           const juce::File &overviewFile,
+           const juce::MD5 &audioFingerprint,
+           float low,
+           float high,
+           std::shared_ptr<std::atomic<bool>> succeededFlag,
+           std::shared_ptr<std::atomic<bool>> finishedFlag,
+           std::shared_ptr<std::atomic<bool>> cancelFlag) :
+  juce::ThreadPoolJob("Waveform overview"),
+  audioFile(audio),
+  destination(overviewFile),
+  fileFingerprint(audioFingerprint),
+  lowCrossover(low),
+  highCrossover(high),
+  succeeded(std::move(succeededFlag)),
+  finished(std::move(finishedFlag)),
+  cancelled(std::move(cancelFlag))
+  {}
+
+  JobStatus runJob() override
+  {
+   auto createReader = ParallelAnalyser::readerFactoryFor(audioFile);
+   succeeded->store(build(&analysisPool->pool, createReader, lowCrossover, highCrossover, fileFingerprint, destination,
+                          [this]() { return shouldExit() || cancelled->load(); }));
+   finished->store(true);
+   return jobHasFinished;
+  }
+ };
+};
@@ -0,0 +1,190 @@
+/*
+ ==============================================================================
+
+ Main.cpp
+ Created: 17 Oct 2026 4:51:22pm
+ Author:  Adam Jackson
+
+ Headless batch analyser. Walks a directory and writes a waveform overview
+ for every audio file it can read, using the same crossover and colour
+ mapping as the plugin, so the scopes can open those files instantly.
+
+ ==============================================================================
+ */
+
+#include <JuceHeader.h>
+#include "../../../Source/ColouredScope.h"
+
+namespace
+{
+
+struct Options
+{
+ juce::File inputDirectory;
+ juce::File overviewDirectory {WaveformOverview::getDefaultCacheDirectory()};
+ juce::File previewDirectory;
+ int previewWidth {2048};
+ int previewHeight {128};
+ int numJobs {juce::SystemStats::getNumCpus()};
+ float lowCrossover {LowXOver};
+ float highCrossover {HighXOver};
+ bool force {false};
+};
+
+void printUsage()
+{
+ std::cout << "Usage: XDLightScopeAnalyser <directory> [options]\n"
+ << "  --output <dir>     Where to write overviews (default: the plugin's cache)\n"
+ << "  --next-to-track    Write each overview next to its track instead\n"
+ << "  --preview <dir>    Also render a coloured PNG strip of each track\n"
+ << "  --width <n>        Preview width in pixels (default 2048)\n"
+ << "  --jobs <n>         Files analysed at once (default: number of cores)\n"
+ << "  --low <hz>         Low crossover (default " << LowXOver << ")\n"
+ << "  --high <hz>        High crossover (default " << HighXOver << ")\n"
+ << "  --force            Rebuild overviews even if they are up to date\n";
+}
+
+bool parseOptions(const juce::StringArray &args, Options &options)
+{
+ for (int i = 0; i < args.size(); ++i)
+ {
+  const juce::String arg = args[i];
+  const bool hasValue = i + 1 < args.size();
+  if (arg == "--output" && hasValue) options.overviewDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+  else if (arg == "--next-to-track") options.overviewDirectory = juce::File();
+  else if (arg == "--preview" && hasValue) options.previewDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+  else if (arg == "--width" && hasValue) options.previewWidth = juce::jmax(1, args[++i].getIntValue());
+  else if (arg == "--jobs" && hasValue) options.numJobs = juce::jmax(1, args[++i].getIntValue());
+  else if (arg == "--low" && hasValue) options.lowCrossover = args[++i].getFloatValue();
+  else if (arg == "--high" && hasValue) options.highCrossover = args[++i].getFloatValue();
+  else if (arg == "--force") options.force = true;
+  else if (!arg.startsWith("--") && options.inputDirectory == juce::File())
+  {
+   options.inputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+  }
+  else return false;
+ }
+
+ return options.inputDirectory.isDirectory();
+}
+
+// Draws each column as a vertical span in the colour the scopes would use
+bool writePreview(const WaveformOverview &overview, const Options &options, const juce::File &destination)
+{
+ const juce::Colour defaultColour {juce::Colours::white.withBrightness(0.5)};
+ const int width = options.previewWidth;
+ const int height = options.previewHeight;
+ const float midPoint = 0.5f*height;
+ juce::Image image(juce::Image::ARGB, width, height, true);
+ juce::Graphics g(image);
+
+ const juce::int64 length = overview.getLengthInSamples();
+ for (int x = 0; x < width; ++x)
+ {
+  const juce::int64 first = length*x/width;
+  const juce::int64 last = juce::jmax(first + 1, length*(x + 1)/width);
+  const SummaryBin bin = overview.query(first, last);
+  const float top = midPoint - midPoint*juce::jlimit(-1.f, 1.f, bin.max);
+  const float bottom = midPoint - midPoint*juce::jlimit(-1.f, 1.f, bin.min);
+  g.setColour(ScopeDataSource::translateSpectrumToColour(bin.bass, bin.mids, bin.high, defaultColour));
+  g.fillRect(static_cast<float>(x), top, 1.f, juce::jmax(1.f, bottom - top));
+ }
+
+ destination.deleteFile();
+ juce::FileOutputStream out(destination);
+ juce::PNGImageFormat png;
+ return out.openedOk() && png.writeImageToStream(image, out);
+}
+
+struct Totals
+{
+ std::atomic<int> analysed {0};
+ std::atomic<int> skipped {0};
+ std::atomic<int> failed {0};
+ std::atomic<juce::int64> samples {0};
+};
+
+void analyseFile(const juce::File &file, const Options &options, Totals &totals)
+{
+ const auto fingerprint = WaveformOverview::fingerprint(file, options.lowCrossover, options.highCrossover);
+ const auto overviewFile = WaveformOverview::getCacheFile(file, fingerprint, options.overviewDirectory);
+
+ std::unique_ptr<WaveformOverview> overview;
+ if (!options.force) overview = WaveformOverview::load(overviewFile, fingerprint);
+ const bool upToDate = overview != nullptr;
+
+ if (!upToDate)
+ {
+  // Files are already analysed in parallel, so each one runs on its own thread
+  if (WaveformOverview::build(nullptr, ParallelAnalyser::readerFactoryFor(file),
+                              options.lowCrossover, options.highCrossover,
+                              fingerprint, overviewFile, []() { return false; }))
+  {
+   overview = WaveformOverview::load(overviewFile, fingerprint);
+  }
+
+  if (!overview)
+  {
+   ++totals.failed;
+   std::cout << "FAILED   " << file.getFullPathName() << std::endl;
+   return;
+  }
+
+  ++totals.analysed;
+  totals.samples += overview->getLengthInSamples();
+ }
+ else ++totals.skipped;
+
+ if (options.previewDirectory != juce::File())
+ {
+  const auto preview = options.previewDirectory.getChildFile(file.getFileNameWithoutExtension() + "-" +
+                                                             fingerprint.toHexString().substring(0, 8) + ".png");
+  if (!upToDate || !preview.existsAsFile()) writePreview(*overview, options, preview);
+ }
+
+ std::cout << (upToDate ? "current  " : "analysed ") << file.getFullPathName() << std::endl;
+}
+
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+ juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+ Options options;
+ juce::StringArray args;
+ for (int i = 1; i < argc; ++i) args.add(juce::String::fromUTF8(argv[i]));
+ if (!parseOptions(args, options))
+ {
+  printUsage();
+  return 1;
+ }
+
+ if (options.previewDirectory != juce::File()) options.previewDirectory.createDirectory();
+
+ juce::AudioFormatManager formatManager;
+ formatManager.registerBasicFormats();
+ const auto files = options.inputDirectory.findChildFiles(juce::File::findFiles, true,
+                                                          formatManager.getWildcardForAllFormats());
+
+ Totals totals;
+ const double startTime = juce::Time::getMillisecondCounterHiRes();
+ {
+  juce::ThreadPool pool(options.numJobs);
+  for (const auto &file: files)
+  {
+   pool.addJob([&options, &totals, file]() { analyseFile(file, options, totals); });
+  }
+  while (pool.getNumJobs() > 0) juce::Thread::sleep(50);
+ }
+ const double seconds = (juce::Time::getMillisecondCounterHiRes() - startTime)/1000.;
+
+ const double rateSeconds = juce::jmax(seconds, 1e-6);
+ std::cout << "\n" << totals.analysed.load() << " analysed, " << totals.skipped.load() << " up to date, "
+ << totals.failed.load() << " failed in " << juce::String(seconds, 2) << "s\n"
+ << juce::String(totals.analysed.load()/rateSeconds, 2) << " files/s, "
+ << juce::String(static_cast<double>(totals.samples.load())/rateSeconds, 0) << " samples/s" << std::endl;
+
+ return totals.failed.load() > 0 ? 2 : 0;
+}